@@ -1,6 +1,8 @@
 #include <iostream>
+#ifndef ZOOSIMS_CORE
 #include <io.h>
 #include <fcntl.h>
+#endif
 #include <vector>
 #include <string>
 #include <cstdlib>
@@ -13,7 +15,34 @@
 #include <iomanip>
 #include <memory>
 #include <unordered_map>
+#include <unordered_set>
 #include <set>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <queue>
+#include <stdexcept>
+#include <array>
+#include <cmath>
+#include <chrono>
+#include <fstream>
+#include <deque>
+#include <cstdint>
+#include <string_view>
+#include <cstdio>
+#include <cstring>
+
+#ifdef ZOOSIMS_CORE
+#include "ZooSIMS.h"
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define ZOOSIMS_SSE2 1
+#endif
 
 using namespace std;
 
@@ -23,6 +52,8 @@ class Zoo;
 class Animal;
 class Enclosure;
 class Worker;
+class ZooJournal;
+class VisitorEngine;
 
 // Перечисления для статусов здоровья животных, их типов, типов вольеров и работников
 
@@ -38,95 +69,620 @@ enum WorkerType {
     WORKER_VET, WORKER_CLEANER, WORKER_FEEDER, WORKER_TRAINER, WORKER_GUIDE
 };
 
+enum FoodType {
+    FOOD_MEAT, FOOD_FISH, FOOD_PLANTS, FOOD_TYPE_COUNT
+};
+
 // Константные данные для игры
 
 const vector<wstring> healthStatus = { L"Здоров", L"Болен", L"Мертв" };
 const vector<wstring> animalTypes = { L"Наземное", L"Водное", L"Птица", L"Рептилия" };
 const vector<wstring> climates = { L"Тропический", L"Умеренный", L"Полярный", L"Пустынный", L"Водный" };
-const vector<wstring> animalSpecies = {
-    L"Лев", L"Тигр", L"Медведь", L"Волк", L"Пингвин",
-    L"Крокодил", L"Слон", L"Носорог", L"Жираф", L"Зебра",
-    L"Дельфин", L"Акула", L"Черепаха", L"Осьминог"
+
+// Встроенный каталог: используется, если файла каталога нет или в нем ошибка.
+// Формат тот же, что у zoo_catalog.txt (описание полей - в самом файле)
+
+const wchar_t* const builtinCatalogText = LR"(
+species|Лев|LAND|Тропический,Пустынный|15|10|1|MEAT|3|9|Львица
+species|Тигр|LAND|Тропический,Умеренный|14|8|1|MEAT|3|9|Тигрица
+species|Медведь|LAND|Умеренный,Полярный|20|15|1|MEAT|2|7|Медведица
+species|Волк|LAND|Умеренный,Полярный|8|5|1|MEAT|2|5|Волчица
+species|Пингвин|BIRD|Полярный|10|7|0|FISH|1|7|
+species|Крокодил|REPTILE|Тропический|30|20|1|MEAT|2|6|
+species|Слон|LAND|Тропический,Пустынный|40|20|0|PLANTS|5|10|
+species|Носорог|LAND|Тропический,Пустынный|35|15|0|PLANTS|4|7|
+species|Жираф|LAND|Тропический,Пустынный|25|10|0|PLANTS|3|8|
+species|Зебра|LAND|Тропический,Пустынный|20|10|0|PLANTS|2|5|
+species|Дельфин|AQUATIC|Водный|30|15|0|FISH|2|9|
+species|Акула|AQUATIC|Водный|40|20|1|FISH|3|8|
+species|Черепаха|REPTILE|Водный,Тропический|50|30|0|PLANTS|1|4|
+species|Осьминог|AQUATIC|Водный|5|3|0|FISH|1|6|
+enclosure|1|SMALL|5|5000|Малый
+enclosure|2|MEDIUM|10|8000|Средний
+enclosure|3|LARGE|15|12000|Большой
+enclosure|4|HUGE|20|15000|Огромный
+enclosure|5|AQUARIUM|3|10000|Аквариум
+enclosure|6|BIRD_CAGE|8|7000|Птичья клетка
+enclosure|7|REPTILE_HOUSE|5|9000|Террариум
+enclosure|8|PETTING_ZOO|10|6000|Контактный зоопарк
+worker|VET|Ветеринар|40000|20
+worker|CLEANER|Уборщик|20000|3
+worker|FEEDER|Кормильщик|25000|2
+worker|TRAINER|Дрессировщик|35000|5
+worker|GUIDE|Экскурсовод|30000|0
+)";
+
+#ifndef ZOOSIMS_CORE
+const char* const catalogFileName = "zoo_catalog.txt";
+#endif
+
+// Названия типов корма
+
+const vector<wstring> foodTypeNames = { L"Мясо", L"Рыба", L"Растительный корм" };
+
+// Цвета терминала: escape-последовательности заготовлены один раз,
+// чтобы при выводе каждой строки не собирать новый wstring
+
+enum TerminalColor : uint8_t {
+    COLOR_DEFAULT, COLOR_DEAD, COLOR_HAPPY, COLOR_CONTENT, COLOR_NEUTRAL, COLOR_UNHAPPY, COLOR_MISERABLE, COLOR_TITLE,
+    COLOR_COUNT
+};
+
+const wchar_t* const terminalColorCodes[COLOR_COUNT] = {
+    L"\033[0m", L"\033[90m", L"\033[32m", L"\033[33m", L"\033[93m", L"\033[31m", L"\033[91m", L"\033[36m"
+};
+
+TerminalColor happinessColor(int happiness, bool alive) {
+    if (!alive) return COLOR_DEAD;
+    if (happiness >= 80) return COLOR_HAPPY;
+    if (happiness >= 60) return COLOR_CONTENT;
+    if (happiness >= 40) return COLOR_NEUTRAL;
+    if (happiness >= 20) return COLOR_UNHAPPY;
+    return COLOR_MISERABLE;
+}
+
+// Генератор случайных чисел симуляции: свой у каждого потока, чтобы несколько
+// зоопарков можно было обсчитывать параллельно без общего состояния rand()
+
+mt19937& simRandomEngine() {
+    thread_local mt19937 engine(random_device{}() ^ static_cast<unsigned>(hash<thread::id>{}(this_thread::get_id())));
+    return engine;
+}
+
+void seedSimRandom(unsigned seed) {
+    simRandomEngine().seed(seed);
+}
+
+int simRand() {
+    return static_cast<int>(simRandomEngine()() >> 1);
+}
+
+// Временная замена генератора текущего потока генератором с заданным зерном;
+// прежнее состояние генератора восстанавливается при выходе из области
+
+class SimRandomScope {
+public:
+    explicit SimRandomScope(unsigned seed) : saved(simRandomEngine()) { seedSimRandom(seed); }
+    ~SimRandomScope() { simRandomEngine() = saved; }
+    SimRandomScope(const SimRandomScope&) = delete;
+    SimRandomScope& operator=(const SimRandomScope&) = delete;
+
+private:
+    mt19937 saved;
 };
 
-// Сопоставление видов животных с подходящими климатами
+// Поток вывода сообщений симуляции. По умолчанию это консоль (в библиотеке ядра - "немой" поток),
+// фоновые зоопарки (например, в ZooHost) подменяют его на "немой" поток
 
-const map<wstring, vector<wstring>> speciesClimates = {
-    {L"Лев", {L"Тропический", L"Пустынный"}},
-    {L"Тигр", {L"Тропический", L"Умеренный"}},
-    {L"Медведь", {L"Умеренный", L"Полярный"}},
-    {L"Волк", {L"Умеренный", L"Полярный"}},
-    {L"Пингвин", {L"Полярный"}},
-    {L"Крокодил", {L"Тропический"}},
-    {L"Слон", {L"Тропический", L"Пустынный"}},
-    {L"Носорог", {L"Тропический", L"Пустынный"}},
-    {L"Жираф", {L"Тропический", L"Пустынный"}},
-    {L"Зебра", {L"Тропический", L"Пустынный"}},
-    {L"Дельфин", {L"Водный"}},
-    {L"Акула", {L"Водный"}},
-    {L"Черепаха", {L"Водный", L"Тропический"}},
-    {L"Осьминог", {L"Водный"}}
+class NullWideBuffer : public wstreambuf {
+protected:
+    int_type overflow(int_type ch) override { return traits_type::not_eof(ch); }
 };
 
-// Сопоставление видов животных с их типами
+wostream& quietStream() {
+    thread_local NullWideBuffer buffer;
+    thread_local wostream stream(&buffer);
+    return stream;
+}
+
+thread_local wostream* currentSimOut = nullptr;
+
+wostream& simOut() {
+#ifdef ZOOSIMS_CORE
+    return currentSimOut ? *currentSimOut : quietStream();
+#else
+    return currentSimOut ? *currentSimOut : wcout;
+#endif
+}
+
+// Выводятся ли сейчас сообщения симуляции (подробные отчеты можно не формировать)
+
+bool simOutQuiet() {
+    return &simOut() == &quietStream();
+}
+
+// Временная подмена потока вывода симуляции в текущем потоке
 
-const map<wstring, AnimalType> speciesTypes = {
-    {L"Лев", AnimalType::LAND}, {L"Тигр", AnimalType::LAND},
-    {L"Медведь", AnimalType::LAND}, {L"Волк", AnimalType::LAND},
-    {L"Пингвин", AnimalType::BIRD}, {L"Крокодил", AnimalType::REPTILE},
-    {L"Слон", AnimalType::LAND}, {L"Носорог", AnimalType::LAND},
-    {L"Жираф", AnimalType::LAND}, {L"Зебра", AnimalType::LAND},
-    {L"Дельфин", AnimalType::AQUATIC}, {L"Акула", AnimalType::AQUATIC},
-    {L"Черепаха", AnimalType::REPTILE}, {L"Осьминог", AnimalType::AQUATIC}
+class SimOutputScope {
+public:
+    explicit SimOutputScope(wostream& out) : previous(currentSimOut) { currentSimOut = &out; }
+    ~SimOutputScope() { currentSimOut = previous; }
+    SimOutputScope(const SimOutputScope&) = delete;
+    SimOutputScope& operator=(const SimOutputScope&) = delete;
+
+private:
+    wostream* previous;
 };
 
-// Названия и зарплаты работников
+// Перевод текста UTF-8 в wstring (на Windows символы вне BMP становятся суррогатными парами)
+
+wstring decodeUtf8(const string& bytes) {
+    wstring result(bytes.size(), L'\0');
+    size_t length = 0;
+    size_t i = bytes.compare(0, 3, "\xEF\xBB\xBF") == 0 ? 3 : 0;
+    while (i < bytes.size()) {
+        unsigned char lead = static_cast<unsigned char>(bytes[i]);
+        if (lead < 0x80) {
+            result[length++] = lead;
+            i++;
+            continue;
+        }
+        int extra = lead < 0xE0 ? 1 : lead < 0xF0 ? 2 : 3;
+        uint32_t code = lead & (0x3F >> extra);
+        for (int k = 1; k <= extra && i + k < bytes.size(); k++) code = (code << 6) | (static_cast<unsigned char>(bytes[i + k]) & 0x3F);
+        i += extra + 1;
+        if (sizeof(wchar_t) == 2 && code > 0xFFFF) {
+            code -= 0x10000;
+            result[length++] = static_cast<wchar_t>(0xD800 + (code >> 10));
+            result[length++] = static_cast<wchar_t>(0xDC00 + (code & 0x3FF));
+        }
+        else {
+            result[length++] = static_cast<wchar_t>(code);
+        }
+    }
+    result.resize(length);
+    return result;
+}
+
+// Перевод wstring в UTF-8 (суррогатные пары из UTF-16 склеиваются)
+
+string encodeUtf8(const wstring& text) {
+    string result;
+    result.reserve(text.size());
+    for (size_t i = 0; i < text.size(); i++) {
+        uint32_t code = static_cast<uint32_t>(text[i]);
+        if (sizeof(wchar_t) == 2 && code >= 0xD800 && code < 0xDC00 && i + 1 < text.size()) {
+            code = 0x10000 + ((code - 0xD800) << 10) + (static_cast<uint32_t>(text[++i]) - 0xDC00);
+        }
+        if (code < 0x80) {
+            result += static_cast<char>(code);
+        }
+        else if (code < 0x800) {
+            result += static_cast<char>(0xC0 | (code >> 6));
+            result += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else if (code < 0x10000) {
+            result += static_cast<char>(0xE0 | (code >> 12));
+            result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (code & 0x3F));
+        }
+        else {
+            result += static_cast<char>(0xF0 | (code >> 18));
+            result += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            result += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            result += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+    return result;
+}
+
+// Каталог игры: виды, типы вольеров и работников. Загружается один раз на процесс
+// из zoo_catalog.txt (или из встроенных данных) и раскладывается в плотные таблицы по номерам:
+// виды по id, вольеры и работники по значению перечисления. Имя вида ищется по идеальному хешу
 
-const map<WorkerType, wstring> workerTypeNames = {
-    {WORKER_VET, L"Ветеринар"}, {WORKER_CLEANER, L"Уборщик"},
-    {WORKER_FEEDER, L"Кормильщик"}, {WORKER_TRAINER, L"Дрессировщик"},
-    {WORKER_GUIDE, L"Экскурсовод"}
+struct SpeciesInfo {
+    int id;
+    wstring name;
+    wstring femaleName;
+    AnimalType type;
+    uint32_t climateMask;
+    int maxAge;
+    bool isPredator;
+    FoodType diet;
+    int dailyRation;
+    int attractiveness;
+
+    // Бит i в climateMask - вид может жить в климате climates[i]
+    bool livesIn(int climate) const { return climate >= 0 && ((climateMask >> climate) & 1u); }
+};
+
+struct EnclosureTypeInfo {
+    int choice;
+    EnclosureType type;
+    int capacity;
+    int price;
+    wstring name;
 };
 
-const map<WorkerType, int> workerBaseSalaries = {
-    {WORKER_VET, 40000}, {WORKER_CLEANER, 20000},
-    {WORKER_FEEDER, 25000}, {WORKER_TRAINER, 35000},
-    {WORKER_GUIDE, 30000}
+struct WorkerTypeInfo {
+    WorkerType type;
+    wstring name;
+    int salary;
+    int capacity;
 };
 
-// Максимальный возраст для каждого вида животных
+// Идеальный хеш для неизменного набора строк (схема "хеш и смещение"): ключи делятся на
+// корзины, и для каждой корзины подбирается число, при котором все ее ключи попадают в свободные
+// ячейки. Поиск - два перемешивания хеша и одно сравнение строки у вызывающего
 
-const map<wstring, int> speciesMaxAge = {
-    {L"Лев", 15 + rand() % 10}, {L"Тигр", 14 + rand() % 8},
-    {L"Медведь", 20 + rand() % 15}, {L"Волк", 8 + rand() % 5},
-    {L"Пингвин", 10 + rand() % 7}, {L"Крокодил", 30 + rand() % 20},
-    {L"Слон", 40 + rand() % 20}, {L"Носорог", 35 + rand() % 15},
-    {L"Жираф", 25 + rand() % 10}, {L"Зебра", 20 + rand() % 10},
-    {L"Дельфин", 30 + rand() % 15}, {L"Акула", 40 + rand() % 20},
-    {L"Черепаха", 50 + rand() % 30}, {L"Осьминог", 5 + rand() % 3}
+class PerfectHashIndex {
+public:
+    bool build(const vector<wstring_view>& keys) {
+        size_t slotCount = 1;
+        while (slotCount < keys.size() + keys.size() / 4 + 1) slotCount <<= 1;
+        mask = slotCount - 1;
+        seeds.assign(keys.size() / 4 + 1, 0);
+        slots.assign(slotCount, -1);
+
+        vector<uint64_t> hashes(keys.size());
+        vector<vector<uint32_t>> buckets(seeds.size());
+        for (size_t i = 0; i < keys.size(); i++) {
+            hashes[i] = hashKey(keys[i]);
+            buckets[bucketOf(hashes[i])].push_back(static_cast<uint32_t>(i));
+        }
+        vector<uint32_t> order(buckets.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<uint32_t>(i);
+        sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+        vector<size_t> taken;
+        for (uint32_t bucket : order) {
+            if (buckets[bucket].empty()) break;
+            // Ключи с одинаковым хешем не разделить никаким смещением
+            for (size_t i = 1; i < buckets[bucket].size(); i++) {
+                for (size_t j = 0; j < i; j++) {
+                    if (hashes[buckets[bucket][i]] == hashes[buckets[bucket][j]]) return false;
+                }
+            }
+            bool placed = false;
+            for (uint32_t seed = 1; seed < maxSeed && !placed; seed++) {
+                taken.clear();
+                placed = true;
+                for (uint32_t key : buckets[bucket]) {
+                    size_t slot = slotOf(hashes[key], seed);
+                    if (slots[slot] >= 0 || std::find(taken.begin(), taken.end(), slot) != taken.end()) {
+                        placed = false;
+                        break;
+                    }
+                    taken.push_back(slot);
+                }
+                if (!placed) continue;
+                seeds[bucket] = seed;
+                for (size_t i = 0; i < taken.size(); i++) slots[taken[i]] = static_cast<int32_t>(buckets[bucket][i]);
+            }
+            if (!placed) return false;
+        }
+        return true;
+    }
+
+// Номер ключа, если key есть в наборе; иначе любой номер или -1 (вызывающий сверяет строку)
+
+    int find(wstring_view key) const {
+        if (slots.empty()) return -1;
+        uint64_t hash = hashKey(key);
+        return slots[slotOf(hash, seeds[bucketOf(hash)])];
+    }
+
+private:
+    static const uint32_t maxSeed = 1u << 20;
+
+    vector<uint32_t> seeds;
+    vector<int32_t> slots;
+    size_t mask = 0;
+
+    static uint64_t mix(uint64_t value) {
+        value ^= value >> 33;
+        value *= 0xFF51AFD7ED558CCDull;
+        value ^= value >> 33;
+        value *= 0xC4CEB9FE1A85EC53ull;
+        return value ^ (value >> 33);
+    }
+
+    static uint64_t hashKey(wstring_view key) {
+        uint64_t hash = 0xCBF29CE484222325ull;
+        for (wchar_t ch : key) {
+            hash ^= static_cast<uint64_t>(ch);
+            hash *= 0x100000001B3ull;
+        }
+        return mix(hash);
+    }
+
+    size_t bucketOf(uint64_t hash) const { return static_cast<size_t>(hash >> 32) % seeds.size(); }
+
+    size_t slotOf(uint64_t hash, uint32_t seed) const {
+        return static_cast<size_t>(mix(hash + seed * (hash | 1))) & mask;
+    }
 };
 
-// Типы вольеров с их характеристиками
+class SpeciesCatalog {
+public:
+    static const SpeciesCatalog& instance() {
+        static const SpeciesCatalog catalog{ Loader() };
+        return catalog;
+    }
+
+// Каталог из текста (формат zoo_catalog.txt) вместо файла и встроенных данных. Действует,
+// только если вызван до первого обращения к instance(); иначе или при ошибке в тексте
+// возвращает false и описание в error
+
+    static bool configure(wstring_view text, wstring& error) {
+        Configured& configured = configuredCatalog();
+        lock_guard<mutex> lock(configured.guard);
+        if (configured.inUse) {
+            error = L"каталог уже используется";
+            return false;
+        }
+        unique_ptr<SpeciesCatalog> parsed(new SpeciesCatalog());
+        if (!parsed->parse(text, error)) return false;
+        parsed->loadedFrom = L"заданный программой";
+        configured.catalog = move(parsed);
+        return true;
+    }
+
+    const SpeciesInfo* find(const wstring& species) const {
+        int id = nameIndex.find(species);
+        return id >= 0 && entries[id].name == species ? &entries[id] : nullptr;
+    }
+
+    const SpeciesInfo& at(int id) const { return entries.at(id); }
+    size_t size() const { return entries.size(); }
+
+// Типы вольеров в порядке меню и поиск по номеру в меню (nullptr, если такого нет)
+
+    const vector<EnclosureTypeInfo>& enclosureTypes() const { return enclosureList; }
+
+    const EnclosureTypeInfo* enclosureByChoice(int choice) const {
+        for (const auto& info : enclosureList) {
+            if (info.choice == choice) return &info;
+        }
+        return nullptr;
+    }
+
+    const wstring& enclosureName(EnclosureType type) const { return enclosureNames[type]; }
+    const WorkerTypeInfo& worker(WorkerType type) const { return workers[type]; }
+
+// Откуда загружен каталог: имя файла или "встроенный"
+
+    const wstring& source() const { return loadedFrom; }
+
+private:
+    vector<SpeciesInfo> entries;
+    PerfectHashIndex nameIndex;
+    vector<EnclosureTypeInfo> enclosureList;
+    array<wstring, ENCLOSURE_PETTING_ZOO + 1> enclosureNames;
+    array<WorkerTypeInfo, WORKER_GUIDE + 1> workers;
+    array<bool, WORKER_GUIDE + 1> workerDefined{};
+    wstring loadedFrom;
+
+// Разбор текста каталога. При ошибке возвращает false и описание в error, каталог не меняется
+
+    bool parse(wstring_view text, wstring& error) {
+        SpeciesCatalog parsed;
+        parsed.entries.reserve(count(text.begin(), text.end(), L'\n') + 1);
+        int lineNumber = 0;
+        size_t position = 0;
+        vector<wstring_view> fields;
+        while (position <= text.size()) {
+            size_t end = text.find(L'\n', position);
+            if (end == wstring_view::npos) end = text.size();
+            wstring_view line = text.substr(position, end - position);
+            position = end + 1;
+            lineNumber++;
+            if (!line.empty() && line.back() == L'\r') line.remove_suffix(1);
+            if (line.empty() || line[0] == L'#') continue;
+            splitFields(line, L'|', fields);
+            if (!parsed.parseLine(fields, error)) {
+                error = L"строка " + to_wstring(lineNumber) + L": " + error;
+                return false;
+            }
+        }
+        if (!parsed.finish(error)) return false;
+        *this = move(parsed);
+        return true;
+    }
+
+    SpeciesCatalog() = default;
+
+    struct Loader {};
+
+    // Каталог, заданный через configure() до первого обращения к instance()
+    struct Configured {
+        mutex guard;
+        bool inUse = false;
+        unique_ptr<SpeciesCatalog> catalog;
+    };
+
+    static Configured& configuredCatalog() {
+        static Configured configured;
+        return configured;
+    }
+
+// Ядро (ZOOSIMS_CORE) не читает файл из текущего каталога и не пишет в консоль:
+// каталог задает программа через configure(), иначе используется встроенный
+
+    explicit SpeciesCatalog(Loader) {
+        Configured& configured = configuredCatalog();
+        lock_guard<mutex> lock(configured.guard);
+        configured.inUse = true;
+        if (configured.catalog) {
+            *this = move(*configured.catalog);
+            configured.catalog.reset();
+            return;
+        }
+        wstring error;
+#ifndef ZOOSIMS_CORE
+        ifstream file(catalogFileName, ios::binary);
+        if (file) {
+            file.seekg(0, ios::end);
+            string bytes(static_cast<size_t>(max<streamoff>(file.tellg(), 0)), '\0');
+            file.seekg(0, ios::beg);
+            file.read(bytes.data(), static_cast<streamsize>(bytes.size()));
+            if (parse(decodeUtf8(bytes), error)) {
+                loadedFrom = decodeUtf8(catalogFileName);
+                return;
+            }
+            wcerr << L"Ошибка в каталоге " << catalogFileName << L" (" << error << L"), используется встроенный каталог" << endl;
+        }
+#endif
+        if (!parse(builtinCatalogText, error)) throw logic_error("builtin catalog is invalid");
+        loadedFrom = L"встроенный";
+    }
+
+    static void splitFields(wstring_view line, wchar_t separator, vector<wstring_view>& fields) {
+        fields.clear();
+        size_t start = 0;
+        while (true) {
+            size_t end = line.find(separator, start);
+            fields.push_back(line.substr(start, end == wstring_view::npos ? wstring_view::npos : end - start));
+            if (end == wstring_view::npos) return;
+            start = end + 1;
+        }
+    }
+
+    static bool parseNumber(wstring_view field, int& value) {
+        if (field.empty() || field.size() > 9) return false;
+        value = 0;
+        for (wchar_t ch : field) {
+            if (ch < L'0' || ch > L'9') return false;
+            value = value * 10 + (ch - L'0');
+        }
+        return true;
+    }
+
+    template <typename T, size_t N>
+    static bool parseToken(wstring_view field, const wchar_t* const (&names)[N], T& value) {
+        for (size_t i = 0; i < N; i++) {
+            if (field == names[i]) {
+                value = static_cast<T>(i);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool parseLine(const vector<wstring_view>& fields, wstring& error) {
+        static const wchar_t* const animalTypeTokens[] = { L"LAND", L"AQUATIC", L"BIRD", L"REPTILE" };
+        static const wchar_t* const foodTokens[] = { L"MEAT", L"FISH", L"PLANTS" };
+        static const wchar_t* const enclosureTokens[] = {
+            L"SMALL", L"MEDIUM", L"LARGE", L"HUGE", L"AQUARIUM", L"BIRD_CAGE", L"REPTILE_HOUSE", L"PETTING_ZOO"
+        };
+        static const wchar_t* const workerTokens[] = { L"VET", L"CLEANER", L"FEEDER", L"TRAINER", L"GUIDE" };
+
+        if (fields[0] == L"species") {
+            SpeciesInfo info;
+            int ageBase = 0;
+            int ageSpread = 0;
+            int predator = 0;
+            if (fields.size() != 11 || fields[1].empty() || !parseToken(fields[2], animalTypeTokens, info.type)
+                || !parseNumber(fields[4], ageBase) || !parseNumber(fields[5], ageSpread) || !parseNumber(fields[6], predator)
+                || !parseToken(fields[7], foodTokens, info.diet) || !parseNumber(fields[8], info.dailyRation)
+                || !parseNumber(fields[9], info.attractiveness)) {
+                error = L"неверная запись вида";
+                return false;
+            }
+            info.id = static_cast<int>(entries.size());
+            info.name = wstring(fields[1]);
+            info.femaleName = wstring(fields[10].empty() ? fields[1] : fields[10]);
+            info.climateMask = 0;
+            size_t start = 0;
+            while (start <= fields[3].size()) {
+                size_t end = min(fields[3].find(L',', start), fields[3].size());
+                wstring_view climate = fields[3].substr(start, end - start);
+                auto known = std::find(climates.begin(), climates.end(), climate);
+                if (known == climates.end()) {
+                    error = L"неизвестный климат " + wstring(climate);
+                    return false;
+                }
+                info.climateMask |= 1u << (known - climates.begin());
+                start = end + 1;
+            }
+            info.maxAge = ageBase + (ageSpread > 0 ? simRand() % ageSpread : 0);
+            info.isPredator = predator != 0;
+            entries.push_back(move(info));
+            return true;
+        }
+        if (fields[0] == L"enclosure") {
+            EnclosureTypeInfo info;
+            if (fields.size() != 6 || !parseNumber(fields[1], info.choice) || !parseToken(fields[2], enclosureTokens, info.type)
+                || !parseNumber(fields[3], info.capacity) || !parseNumber(fields[4], info.price) || fields[5].empty()) {
+                error = L"неверная запись вольера";
+                return false;
+            }
+            if (enclosureByChoice(info.choice)) {
+                error = L"повторный номер вольера " + wstring(fields[1]);
+                return false;
+            }
+            info.name = wstring(fields[5]);
+            enclosureNames[info.type] = info.name;
+            enclosureList.push_back(move(info));
+            return true;
+        }
+        if (fields[0] == L"worker") {
+            WorkerTypeInfo info;
+            if (fields.size() != 5 || !parseToken(fields[1], workerTokens, info.type) || fields[2].empty()
+                || !parseNumber(fields[3], info.salary) || !parseNumber(fields[4], info.capacity)) {
+                error = L"неверная запись работника";
+                return false;
+            }
+            info.name = wstring(fields[2]);
+            workerDefined[info.type] = true;
+            workers[info.type] = move(info);
+            return true;
+        }
+        error = L"неизвестная запись " + wstring(fields[0]);
+        return false;
+    }
 
-const map<int, tuple<EnclosureType, int, int, wstring>> enclosureTypes = {
-    {1, {ENCLOSURE_SMALL, 5, 5000, L"Малый"}},
-    {2, {ENCLOSURE_MEDIUM, 10, 8000, L"Средний"}},
-    {3, {ENCLOSURE_LARGE, 15, 12000, L"Большой"}},
-    {4, {ENCLOSURE_HUGE, 20, 15000, L"Огромный"}},
-    {5, {ENCLOSURE_AQUARIUM, 3, 10000, L"Аквариум"}},
-    {6, {ENCLOSURE_BIRD_CAGE, 8, 7000, L"Птичья клетка"}},
-    {7, {ENCLOSURE_REPTILE_HOUSE, 5, 9000, L"Террариум"}},
-    {8, {ENCLOSURE_PETTING_ZOO, 10, 6000, L"Контактный зоопарк"}}
+    bool finish(wstring& error) {
+        if (entries.empty() || enclosureList.empty()) {
+            error = L"нет видов или вольеров";
+            return false;
+        }
+        for (bool defined : workerDefined) {
+            if (!defined) {
+                error = L"описаны не все типы работников";
+                return false;
+            }
+        }
+        sort(enclosureList.begin(), enclosureList.end(),
+            [](const EnclosureTypeInfo& a, const EnclosureTypeInfo& b) { return a.choice < b.choice; });
+
+        vector<wstring_view> names;
+        names.reserve(entries.size());
+        for (const auto& info : entries) names.push_back(info.name);
+        if (nameIndex.build(names)) return true;
+
+        // Индекс не строится только при повторе имени (или совпадении 64-битных хешей)
+        sort(names.begin(), names.end());
+        auto duplicate = adjacent_find(names.begin(), names.end());
+        error = duplicate != names.end() ? L"повторный вид " + wstring(*duplicate) : L"не удалось построить индекс видов";
+        return false;
+    }
 };
 
+// Оценка объема памяти строки в куче (0, если строка уместилась во внутренний буфер)
+
+size_t heapBytes(const wstring& str) {
+    const char* data = reinterpret_cast<const char*>(str.data());
+    const char* self = reinterpret_cast<const char*>(&str);
+    if (data >= self && data < self + sizeof(str)) return 0;
+    return (str.capacity() + 1) * sizeof(wchar_t);
+}
+
 // Генерация имени животного в зависимости от пола
 
 wstring generateAnimalName(const wstring& species, wchar_t gender) {
     if (gender == 'F') {
-        if (species == L"Лев") return L"Львица";
-        if (species == L"Тигр") return L"Тигрица";
-        if (species == L"Медведь") return L"Медведица";
-        if (species == L"Волк") return L"Волчица";
+        if (const SpeciesInfo* info = SpeciesCatalog::instance().find(species)) return info->femaleName;
     }
     return species;
 }
@@ -137,6 +693,7 @@ bool isNumber(const wstring& str) {
     return !str.empty() && all_of(str.begin(), str.end(), [](wchar_t ch) { return iswdigit(ch); });
 }
 
+#ifndef ZOOSIMS_CORE
 // Безопасный ввод строки с проверкой на пустоту
 
 wstring safeInputString(const wstring& prompt) {
@@ -160,6 +717,261 @@ int safeInputInt(const wstring& prompt) {
         wcout << L"Пожалуйста, введите число: ";
     }
 }
+#endif
+
+// Наследуемые признаки животного
+
+enum GeneTrait { GENE_SIZE, GENE_LIFESPAN, GENE_RESISTANCE, GENE_TEMPERAMENT, GENE_TRAIT_COUNT };
+
+const wchar_t* const geneTraitNames[GENE_TRAIT_COUNT] = { L"размер", L"долголетие", L"устойчивость", L"нрав" };
+
+// Геном животного: 4 признака по 4 бита (0-15, 8 - средний) в одном 16-битном слове,
+// признак t занимает биты 4t..4t+3. Все признаки обрабатываются разом операциями над словом,
+// а SSE2 обрабатывает 4 генома за шаг
+
+class Genome {
+public:
+    static int trait(uint16_t genome, GeneTrait t) { return (genome >> (4 * t)) & 15; }
+
+// Случайный геном купленного животного: каждый признак от 4 до 12
+
+    static uint16_t random(uint32_t bits) {
+        uint16_t genome = 0;
+        for (int t = 0; t < GENE_TRAIT_COUNT; t++) {
+            genome |= static_cast<uint16_t>((4 + ((bits >> (8 * t)) & 0xFF) % 9) << (4 * t));
+        }
+        return genome;
+    }
+
+// Величина, растущая с признаком: при 8 не меняется, при 0 - 75%, при 15 - 122%
+
+    static int scale(uint16_t genome, GeneTrait t, int value) { return value * (24 + trait(genome, t)) / 32; }
+
+    static wstring describe(uint16_t genome) {
+        wstring text;
+        for (int t = 0; t < GENE_TRAIT_COUNT; t++) {
+            if (t > 0) text += L", ";
+            text += wstring(geneTraitNames[t]) + L" " + to_wstring(trait(genome, static_cast<GeneTrait>(t)));
+        }
+        return text;
+    }
+
+// Геномы детенышей: каждый признак целиком берется от отца или от матери, затем с вероятностью
+// 1/16 мутирует (переключается младший бит, признак меняется на 1). Случайные биты детеныша i
+// зависят только от seed и i, поэтому скалярный вариант и SSE2 дают одинаковые геномы
+
+    static void inherit(const uint16_t* fathers, const uint16_t* mothers, uint16_t* children, size_t count, uint32_t seed) {
+        size_t i = 0;
+#ifdef ZOOSIMS_SSE2
+        for (; i + 4 <= count; i += 4) inheritSse2(fathers + i, mothers + i, children + i, seed + static_cast<uint32_t>(i) * seedStep);
+#endif
+        for (; i < count; i++) {
+            uint32_t state = (seed + static_cast<uint32_t>(i) * seedStep) | 1u;
+            children[i] = inheritOne(fathers[i], mothers[i], nextRandom(nextRandom(nextRandom(state))));
+        }
+    }
+
+private:
+    static constexpr uint32_t seedStep = 0x9E3779B9u;
+    static constexpr uint32_t lowBits = 0x1111u;
+
+    static uint32_t nextRandom(uint32_t state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+// Младшие 16 бит выбирают родителя по младшему биту каждого признака, старшие 16 - мутацию
+// (все 4 бита признака единичные)
+
+    static uint16_t inheritOne(uint32_t father, uint32_t mother, uint32_t bits) {
+        uint32_t pick = bits & lowBits;
+        uint32_t fromFather = (pick << 4) - pick;
+        uint32_t child = (father & fromFather) | (mother & ~fromFather);
+        uint32_t roll = bits >> 16;
+        child ^= roll & (roll >> 1) & (roll >> 2) & (roll >> 3) & lowBits;
+        return static_cast<uint16_t>(child);
+    }
+
+#ifdef ZOOSIMS_SSE2
+    static __m128i nextRandom(__m128i state) {
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+        state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+        return _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+    }
+
+    static void inheritSse2(const uint16_t* fathers, const uint16_t* mothers, uint16_t* children, uint32_t seed) {
+        const __m128i laneOffsets = _mm_setr_epi32(0, static_cast<int>(seedStep), static_cast<int>(2 * seedStep),
+            static_cast<int>(3 * seedStep));
+        const __m128i low = _mm_set1_epi32(static_cast<int>(lowBits));
+        const __m128i zero = _mm_setzero_si128();
+        __m128i state = _mm_or_si128(_mm_add_epi32(_mm_set1_epi32(static_cast<int>(seed)), laneOffsets), _mm_set1_epi32(1));
+        state = nextRandom(nextRandom(nextRandom(state)));
+
+        __m128i father = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(fathers)), zero);
+        __m128i mother = _mm_unpacklo_epi16(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(mothers)), zero);
+        __m128i pick = _mm_and_si128(state, low);
+        __m128i fromFather = _mm_sub_epi32(_mm_slli_epi32(pick, 4), pick);
+        __m128i child = _mm_or_si128(_mm_and_si128(fromFather, father), _mm_andnot_si128(fromFather, mother));
+        __m128i roll = _mm_srli_epi32(state, 16);
+        __m128i mutation = _mm_and_si128(_mm_and_si128(roll, _mm_srli_epi32(roll, 1)),
+            _mm_and_si128(_mm_srli_epi32(roll, 2), _mm_srli_epi32(roll, 3)));
+        child = _mm_xor_si128(child, _mm_and_si128(mutation, low));
+
+        // Младшие 16 бит четырех 32-битных дорожек - в младшие 64 бита регистра
+        child = _mm_shufflelo_epi16(child, _MM_SHUFFLE(3, 3, 2, 0));
+        child = _mm_shufflehi_epi16(child, _MM_SHUFFLE(3, 3, 2, 0));
+        child = _mm_shuffle_epi32(child, _MM_SHUFFLE(3, 3, 2, 0));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(children), child);
+    }
+#endif
+};
+
+// Хранилище объектов Animal: у каждого потока свое, ячейки одного размера в блоках. Блоки со
+// свободными ячейками связаны в список прямо через свои заголовки, новое животное занимает
+// ячейку первого блока списка; дефрагментация (Zoo::defragmentAnimals) берет под всех животных
+// зоопарка один новый блок подряд. Один опустевший блок обычного размера хранилище держит
+// про запас, остальные опустевшие блоки возвращаются системе. Перед каждым объектом лежит
+// указатель на его блок, блок знает свое хранилище: ячейку, освобожденную чужим потоком,
+// хранилище забирает из очереди возврата при следующем выделении. Хранилище завершившегося
+// потока подбирает новый поток
+
+class AnimalSlab {
+public:
+    static AnimalSlab& local();
+
+    AnimalSlab(size_t objectBytes, size_t objectAlign)
+        : align(max(objectAlign, alignof(Block*))),
+          slotBytes(roundUp(objectBytes + sizeof(Block*))),
+          firstOffset(roundUp(sizeof(Block) + sizeof(Block*))) {}
+
+// Расстояние между соседними объектами блока
+
+    size_t slotSize() const { return slotBytes; }
+
+    void* allocate() {
+        collectReturned();
+        if (!available) {
+            link(spare ? spare : addBlock(blockSlots));
+            spare = nullptr;
+        }
+        Block* block = available;
+        char* object = block->freeList;
+        if (object) block->freeList = nextFree(object);
+        else object = objectAt(block, block->used++);
+        block->live++;
+        if (!block->freeList && block->used == block->slots) unlink(block);
+        return object;
+    }
+
+// count объектов подряд в отдельном блоке (count > 0)
+
+    void* allocateRun(size_t count) {
+        collectReturned();
+        Block* block = addBlock(count);
+        block->used = count;
+        block->live = count;
+        return objectAt(block, 0);
+    }
+
+    static void deallocate(void* place) {
+        char* object = static_cast<char*>(place);
+        Block* block = reinterpret_cast<Block**>(object)[-1];
+        if (block->owner == current) block->owner->release(block, object);
+        else block->owner->returnSlot(object);
+    }
+
+private:
+    static constexpr size_t blockSlots = 1024;
+
+    struct Block {
+        AnimalSlab* owner;
+        size_t slots;
+        size_t used;
+        size_t live;
+        char* freeList;
+        Block* prev;
+        Block* next;
+        bool listed;
+    };
+
+    size_t roundUp(size_t bytes) const { return (bytes + align - 1) / align * align; }
+    static char*& nextFree(char* object) { return *reinterpret_cast<char**>(object); }
+    char* objectAt(Block* block, size_t index) const { return reinterpret_cast<char*>(block) + firstOffset + slotBytes * index; }
+
+    Block* addBlock(size_t slots) {
+        Block* block = new (::operator new(firstOffset + slots * slotBytes)) Block{ this, slots, 0, 0, nullptr, nullptr, nullptr, false };
+        for (size_t i = 0; i < slots; i++) reinterpret_cast<Block**>(objectAt(block, i))[-1] = block;
+        return block;
+    }
+
+// Список блоков со свободными ячейками: O(1) и без выделения памяти, поэтому освобождение
+// (вызывается из operator delete) не может бросить исключение
+
+    void link(Block* block) {
+        block->prev = nullptr;
+        block->next = available;
+        if (available) available->prev = block;
+        available = block;
+        block->listed = true;
+    }
+
+    void unlink(Block* block) {
+        if (!block->listed) return;
+        if (block->prev) block->prev->next = block->next;
+        else available = block->next;
+        if (block->next) block->next->prev = block->prev;
+        block->listed = false;
+    }
+
+// Опустевший блок обычного размера остается запасным (заголовки ячеек в нем не меняются),
+// чтобы рождение после смерти последнего жильца не выделяло блок заново
+
+    void release(Block* block, char* object) {
+        if (--block->live == 0) {
+            unlink(block);
+            if (block->slots == blockSlots && !spare) {
+                block->used = 0;
+                block->freeList = nullptr;
+                spare = block;
+            } else {
+                ::operator delete(block);
+            }
+            return;
+        }
+        nextFree(object) = block->freeList;
+        block->freeList = object;
+        if (!block->listed) link(block);
+    }
+
+    void returnSlot(char* object) {
+        char* head = returned.load(memory_order_relaxed);
+        do {
+            nextFree(object) = head;
+        } while (!returned.compare_exchange_weak(head, object, memory_order_release, memory_order_relaxed));
+    }
+
+    void collectReturned() {
+        char* object = returned.exchange(nullptr, memory_order_acquire);
+        while (object) {
+            char* next = nextFree(object);
+            release(reinterpret_cast<Block**>(object)[-1], object);
+            object = next;
+        }
+    }
+
+    static thread_local AnimalSlab* current;
+
+    size_t align;
+    size_t slotBytes;
+    size_t firstOffset;
+    Block* available = nullptr;
+    Block* spare = nullptr;
+    atomic<char*> returned{ nullptr };
+};
+
+thread_local AnimalSlab* AnimalSlab::current = nullptr;
 
 // Класс Animal: представляет животное в зоопарке
 
@@ -170,6 +982,7 @@ public:
     int id;
     wstring name;
     wstring species;
+    int speciesId;
     int age;
     int weight;
     wstring climate;
@@ -187,18 +1000,37 @@ public:
     AnimalType type;
     int daysSick;
     bool hasDisease;
+    // Наследуемые признаки (см. Genome): рост детенышей, предельный возраст, шанс заболеть, потеря счастья
+    uint16_t genome;
+    // Вольер, в котором живет животное (nullptr - вне вольеров); ведет Enclosure
+    Enclosure* home;
+
+    // Наибольший шанс заболеть за день (промилле), у животного с устойчивостью 0
+    static constexpr int maxInfectionChance = 75;
 
-// Конструктор животного
+// Объекты животных живут в ячейках AnimalSlab
 
-    Animal(int _id, wstring n, wstring s, int a, int w, wstring c, bool pred, int p, wchar_t g, int maxA = -1, int p1 = -1, int p2 = -1)
-        : id(_id), name(move(n)), species(move(s)), age(a), weight(w), climate(move(c)), isPredator(pred), price(p),
-        trueHappiness(70 + rand() % 31), displayedHappiness(trueHappiness), lastUpdateTime(time(0)),
+    static void* operator new(size_t) { return AnimalSlab::local().allocate(); }
+    static void* operator new(size_t, void* place) { return place; }
+    static void operator delete(void* place) { AnimalSlab::deallocate(place); }
+    static void operator delete(void*, void*) {}
+
+// Конструктор животного (genes = -1 - случайный геном, maxA = -1 - предельный возраст по виду и геному)
+
+    Animal(int _id, wstring n, wstring s, int a, int w, wstring c, bool pred, int p, wchar_t g, int maxA = -1, int p1 = -1, int p2 = -1,
+        int genes = -1)
+        : id(_id), name(move(n)), species(move(s)), speciesId(-1), age(a), weight(w), climate(move(c)), isPredator(pred), price(p),
+        trueHappiness(70 + simRand() % 31), displayedHappiness(trueHappiness), lastUpdateTime(time(0)),
         gender(g), isAlive(true), maxAge(maxA), parentId1(p1), parentId2(p2), health(AnimalHealth::HEALTHY),
-        type(speciesTypes.at(species)), daysSick(0), hasDisease(false) {
+        type(AnimalType::LAND), daysSick(0), hasDisease(false),
+        genome(genes >= 0 ? static_cast<uint16_t>(genes) : Genome::random(static_cast<uint32_t>(simRand()))), home(nullptr) {
+        const SpeciesInfo* info = SpeciesCatalog::instance().find(species);
+        if (!info) throw invalid_argument("unknown species");
+        speciesId = info->id;
+        type = info->type;
         name = generateAnimalName(species, gender);
         if (maxAge == -1) {
-            auto it = speciesMaxAge.find(species);
-            maxAge = (it != speciesMaxAge.end()) ? it->second : (10 + rand() % 10);
+            maxAge = max(1, Genome::scale(genome, GENE_LIFESPAN, (info->maxAge != -1) ? info->maxAge : (10 + simRand() % 10)));
         }
         if (age < 3) {
             trueHappiness = min(100, trueHappiness + 15);
@@ -212,13 +1044,8 @@ public:
 
 // Получение цвета для отображения уровня счастья
 
-    wstring getHappinessColor() const {
-        if (!isAlive) return L"\033[90m";
-        if (displayedHappiness >= 80) return L"\033[32m";
-        if (displayedHappiness >= 60) return L"\033[33m";
-        if (displayedHappiness >= 40) return L"\033[93m";
-        if (displayedHappiness >= 20) return L"\033[31m";
-        return L"\033[91m";
+    const wchar_t* getHappinessColor() const {
+        return terminalColorCodes[happinessColor(displayedHappiness, isAlive)];
     }
 
 // Обновление уровня счастья на основе условий содержания
@@ -231,16 +1058,18 @@ public:
         if (!isClean) change -= 20;
         if (isAlone) change -= (isPredator ? 10 : 20);
         if (hasDisease) change -= 15;
+        // Спокойный нрав смягчает потери: при 8 без изменений, при 0 - 150%, при 15 - 56%
+        change = change * (24 - Genome::trait(genome, GENE_TEMPERAMENT)) / 16;
         trueHappiness = max(0, min(100, trueHappiness + change));
         displayedHappiness = trueHappiness;
-        if (oldHappiness != trueHappiness) {
+        if (oldHappiness != trueHappiness && !simOutQuiet()) {
             wstring message = name + L" (ID:" + to_wstring(id) + L") ";
             if (!isFed) message += L"голодает! ";
             if (!isClean) message += L"в грязном вольере! ";
             if (isAlone) message += L"одинок! ";
             if (hasDisease) message += L"болен! ";
             message += L"Счастье: " + to_wstring(oldHappiness) + L"% -> " + to_wstring(trueHappiness) + L"%";
-            wcout << message << endl;
+            simOut() << message << endl;
         }
     }
 
@@ -250,8 +1079,8 @@ public:
         if (!isAlive) return false;
         if (trueHappiness <= 15) {
             int escapeChance = 25 - trueHappiness;
-            if (rand() % 100 < escapeChance) {
-                wcout << L"!!! " << name << L" (ID:" << id << L") сбежал из-за низкого уровня счастья (" << trueHappiness << L"%)!" << endl;
+            if (simRand() % 100 < escapeChance) {
+                simOut() << L"!!! " << name << L" (ID:" << id << L") сбежал из-за низкого уровня счастья (" << trueHappiness << L"%)!" << endl;
                 isAlive = false;
                 return true;
             }
@@ -264,8 +1093,8 @@ public:
     bool checkAge() {
         if (age > maxAge) {
             int deathChance = min(100, age - maxAge);
-            if (rand() % 100 < deathChance) {
-                wcout << name << L" (ID:" << id << L") умер от старости в возрасте " << age << L" дней." << endl;
+            if (simRand() % 100 < deathChance) {
+                simOut() << name << L" (ID:" << id << L") умер от старости в возрасте " << age << L" дней." << endl;
                 isAlive = false;
                 return true;
             }
@@ -277,7 +1106,7 @@ public:
 
     void rename(const wstring& newName) {
         name = newName;
-        wcout << L"Животное ID:" << id << L" теперь зовут " << name << endl;
+        simOut() << L"Животное ID:" << id << L" теперь зовут " << name << endl;
     }
 
 // Проверка возможности размножения
@@ -296,85 +1125,98 @@ public:
         vector<unique_ptr<Animal>> offspring;
 
         if (!this->canReproduce() || !other.canReproduce()) {
-            wcout << L"Одно из животных не может размножаться (слишком молодое/старое, мертвое или больное)!" << endl;
+            simOut() << L"Одно из животных не может размножаться (слишком молодое/старое, мертвое или больное)!" << endl;
             return offspring;
         }
 
         if (this->gender == other.gender) {
-            wcout << L"Однополые животные не могут размножаться!" << endl;
+            simOut() << L"Однополые животные не могут размножаться!" << endl;
             return offspring;
         }
 
         Animal* father = (this->gender == 'M') ? this : &other;
         Animal* mother = (this->gender == 'F') ? this : &other;
 
-        int offspringCount = 1;
-        int chance = rand() % 100;
-
-        if (species == L"Носорог" || species == L"Слон" || species == L"Жираф") {
-            offspringCount = 1;
-        }
-        else if (species == L"Лев" || species == L"Тигр") {
-            if (chance < 40) offspringCount = 1;
-            else if (chance < 80) offspringCount = 2;
-            else offspringCount = 3;
-        }
-        else {
-            if (chance < 60) offspringCount = 1;
-            else if (chance < 90) offspringCount = 2;
-            else offspringCount = 3;
-        }
-
+        int offspringCount = litterSize();
+        vector<uint16_t> fathers(offspringCount, father->genome);
+        vector<uint16_t> mothers(offspringCount, mother->genome);
+        vector<uint16_t> genomes(offspringCount);
+        Genome::inherit(fathers.data(), mothers.data(), genomes.data(), genomes.size(), static_cast<uint32_t>(simRand()));
         for (int i = 0; i < offspringCount; i++) {
-            wstring babyName = L"Детеныш " + species;
-
-            if (species == L"Носорог") babyName = L"Носорожок";
-            else if (species == L"Слон") babyName = L"Слонёнок";
-            else if (species == L"Жираф") babyName = L"Жирафёнок";
-            else if (species == L"Лев") babyName = L"Львёнок";
-            else if (species == L"Тигр") babyName = L"Тигрёнок";
-            else if (species == L"Дельфин") babyName = L"Дельфинёнок";
-            else if (species == L"Акула") babyName = L"Акулёнок";
-
-            int babyWeight = (father->weight + mother->weight) / (10 + rand() % 5);
-            int babyPrice = (father->price + mother->price) / (4 + rand() % 3);
-            wchar_t babyGender = (rand() % 2) ? 'M' : 'F';
-
-            offspring.push_back(make_unique<Animal>(
-                0, babyName, species, 0, babyWeight, mother->climate,
-                mother->isPredator, babyPrice, babyGender, -1, father->id, mother->id
-            ));
+            offspring.push_back(makeBaby(*father, *mother, genomes[i]));
         }
 
-        wcout << L"Родилось " << offspringCount << L" "
+        simOut() << L"Родилось " << offspringCount << L" "
             << (offspringCount == 1 ? L"детёныш" : L"детёнышей") << L" " << species << L"!" << endl;
         return offspring;
     }
 
+// Размер помета: у носорогов, слонов и жирафов один детеныш, у остальных до трех
+
+    int litterSize() const {
+        int chance = simRand() % 100;
+        if (species == L"Носорог" || species == L"Слон" || species == L"Жираф") return 1;
+        if (species == L"Лев" || species == L"Тигр") return chance < 40 ? 1 : (chance < 80 ? 2 : 3);
+        return chance < 60 ? 1 : (chance < 90 ? 2 : 3);
+    }
+
+// Детеныш пары с готовым геномом: вес зависит от признака размера, климат и хищность - от матери
+
+    unique_ptr<Animal> makeBaby(const Animal& father, const Animal& mother, uint16_t genes) const {
+        wstring babyName = L"Детеныш " + species;
+
+        if (species == L"Носорог") babyName = L"Носорожок";
+        else if (species == L"Слон") babyName = L"Слонёнок";
+        else if (species == L"Жираф") babyName = L"Жирафёнок";
+        else if (species == L"Лев") babyName = L"Львёнок";
+        else if (species == L"Тигр") babyName = L"Тигрёнок";
+        else if (species == L"Дельфин") babyName = L"Дельфинёнок";
+        else if (species == L"Акула") babyName = L"Акулёнок";
+
+        int babyWeight = Genome::scale(genes, GENE_SIZE, (father.weight + mother.weight) / (10 + simRand() % 5));
+        int babyPrice = (father.price + mother.price) / (4 + simRand() % 3);
+        wchar_t babyGender = (simRand() % 2) ? 'M' : 'F';
+
+        return make_unique<Animal>(
+            0, babyName, species, 0, babyWeight, mother.climate,
+            mother.isPredator, babyPrice, babyGender, -1, father.id, mother.id, genes
+        );
+    }
+
+// Заражение здорового животного
+
+    bool infect() {
+        if (!isAlive || health != AnimalHealth::HEALTHY) return false;
+        health = AnimalHealth::SICK;
+        hasDisease = true;
+        daysSick = 1;
+        simOut() << name << L" (ID:" << id << L") заболел!" << endl;
+        return true;
+    }
+
+// Шанс заболеть за день в промилле: 5% при средней устойчивости, от 2.8% до 7.5%
+
+    int infectionChance() const { return 50 * (24 - Genome::trait(genome, GENE_RESISTANCE)) / 16; }
+
 // Проверка болезни животного
 
     void checkDisease() {
         if (!isAlive || health == AnimalHealth::DEAD) return;
 
         if (health == AnimalHealth::HEALTHY) {
-            if (rand() % 100 < 5) {
-                health = AnimalHealth::SICK;
-                hasDisease = true;
-                daysSick = 1;
-                wcout << name << L" (ID:" << id << L") заболел!" << endl;
-            }
+            if (simRand() % 1000 < infectionChance()) infect();
         }
         else if (health == AnimalHealth::SICK) {
             daysSick++;
-            if (daysSick > 5 && rand() % 100 < 30) {
+            if (daysSick > 5 && simRand() % 100 < 30) {
                 health = AnimalHealth::DEAD;
                 isAlive = false;
-                wcout << name << L" (ID:" << id << L") умер от болезни!" << endl;
+                simOut() << name << L" (ID:" << id << L") умер от болезни!" << endl;
             }
-            else if (daysSick > 3 && rand() % 100 < 20) {
+            else if (daysSick > 3 && simRand() % 100 < 20) {
                 health = AnimalHealth::HEALTHY;
                 hasDisease = false;
-                wcout << name << L" (ID:" << id << L") выздоровел!" << endl;
+                simOut() << name << L" (ID:" << id << L") выздоровел!" << endl;
             }
         }
     }
@@ -392,6 +1234,43 @@ public:
     AnimalType getType() const { return type; }
 };
 
+// Хранилища не разрушаются: животные могут пережить поток, в котором родились, а животные
+// статических объектов освобождаются после выхода из main. При завершении потока его
+// хранилище уходит в общий запас, откуда его берет следующий поток
+
+AnimalSlab& AnimalSlab::local() {
+    struct Retired {
+        mutex guard;
+        vector<AnimalSlab*> slabs;
+    };
+    struct Retirement {
+        ~Retirement() {
+            if (!current) return;
+            Retired& pool = retired();
+            lock_guard<mutex> lock(pool.guard);
+            pool.slabs.push_back(current);
+            current = nullptr;
+        }
+        static Retired& retired() {
+            static Retired* pool = new Retired();
+            return *pool;
+        }
+    };
+    if (!current) {
+        Retired& pool = Retirement::retired();
+        {
+            lock_guard<mutex> lock(pool.guard);
+            if (!pool.slabs.empty()) {
+                current = pool.slabs.back();
+                pool.slabs.pop_back();
+            }
+        }
+        if (!current) current = new AnimalSlab(sizeof(Animal), alignof(Animal));
+        thread_local Retirement retirement;
+    }
+    return *current;
+}
+
 // Класс Enclosure: представляет вольер в зоопарке
 
 class Enclosure {
@@ -403,24 +1282,19 @@ public:
     int maintenanceCost;
     bool isClean;
     vector<Animal*> containedAnimals;
+    // Изменились ли с прошлого пересчета счастья его входы: состав, чистота, болезни жильцов
+    // (см. Zoo::runHappinessSystem)
+    bool happinessDirty;
 
 // Конструктор вольера
     
     Enclosure(int _id, int c, EnclosureType t, wstring cl, int cost)
-        : id(_id), capacity(c), type(t), climate(move(cl)), maintenanceCost(cost), isClean(true) {
+        : id(_id), capacity(c), type(t), climate(move(cl)), maintenanceCost(cost), isClean(true), happinessDirty(true) {
     }
 
 // Получение названия типа вольера
 
-    wstring getTypeName() const {
-        static const map<EnclosureType, wstring> typeNames = {
-            {ENCLOSURE_SMALL, L"Малый"}, {ENCLOSURE_MEDIUM, L"Средний"},
-            {ENCLOSURE_LARGE, L"Большой"}, {ENCLOSURE_HUGE, L"Огромный"},
-            {ENCLOSURE_AQUARIUM, L"Аквариум"}, {ENCLOSURE_BIRD_CAGE, L"Птичья клетка"},
-            {ENCLOSURE_REPTILE_HOUSE, L"Террариум"}, {ENCLOSURE_PETTING_ZOO, L"Контактный зоопарк"}
-        };
-        return typeNames.at(type);
-    }
+    const wstring& getTypeName() const { return SpeciesCatalog::instance().enclosureName(type); }
 
 // Проверка подходит ли вольер для типа животного
 
@@ -436,9 +1310,10 @@ public:
 // Обновление состояния чистоты вольера
 
     void updateCleanliness() {
-        if (!containedAnimals.empty() && rand() % 3 == 0) {
+        if (!containedAnimals.empty() && simRand() % 3 == 0) {
+            if (isClean) happinessDirty = true;
             isClean = false;
-            wcout << L"Вольер ID:" << id << L" (" << getTypeName() << L") стал грязным." << endl;
+            simOut() << L"Вольер ID:" << id << L" (" << getTypeName() << L") стал грязным." << endl;
         }
     }
 
@@ -446,28 +1321,38 @@ public:
 
     bool addAnimal(Animal* animal) {
         if (containedAnimals.size() >= static_cast<size_t>(capacity)) {
-            wcout << L"Вольер переполнен!" << endl;
+            simOut() << L"Вольер переполнен!" << endl;
             return false;
         }
         if (animal->climate != climate) {
-            wcout << L"Климат вольера не подходит для этого животного!" << endl;
+            simOut() << L"Климат вольера не подходит для этого животного!" << endl;
             return false;
         }
         if (!isSuitableForAnimalType(animal->getType())) {
-            wcout << L"Тип вольера не подходит для этого животного!" << endl;
+            simOut() << L"Тип вольера не подходит для этого животного!" << endl;
             return false;
         }
-        containedAnimals.push_back(animal);
-        wcout << animal->name << L" (ID:" << animal->id << L") помещен в вольер ID:" << id << endl;
+        attach(animal);
+        simOut() << animal->name << L" (ID:" << animal->id << L") помещен в вольер ID:" << id << endl;
         return true;
     }
 
+// Заселение без проверок (восстановление сохраненного состояния)
+
+    void attach(Animal* animal) {
+        containedAnimals.push_back(animal);
+        animal->home = this;
+        happinessDirty = true;
+    }
+
 // Удаление животного из вольера
 
     bool removeAnimal(int animalId) {
         for (auto it = containedAnimals.begin(); it != containedAnimals.end(); ++it) {
             if ((*it)->id == animalId) {
+                (*it)->home = nullptr;
                 containedAnimals.erase(it);
+                happinessDirty = true;
                 return true;
             }
         }
@@ -477,8 +1362,9 @@ public:
 // Очистка вольера
 
     void clean() {
+        if (!isClean) happinessDirty = true;
         isClean = true;
-        wcout << L"Вольер ID:" << id << L" (" << getTypeName() << L") был почищен." << endl;
+        simOut() << L"Вольер ID:" << id << L" (" << getTypeName() << L") был почищен." << endl;
     }
 
 // Получение животных определенного пола
@@ -507,8 +1393,9 @@ public:
         }
 
         if (hasSickAnimal) {
+            happinessDirty = true;
             for (auto animal : containedAnimals) {
-                if (animal->getHealth() == AnimalHealth::HEALTHY && rand() % 100 < 20) {
+                if (animal->getHealth() == AnimalHealth::HEALTHY && simRand() % 100 < 20) {
                     animal->checkDisease();
                 }
             }
@@ -529,39 +1416,14 @@ public:
 // Конструктор работника
 
     Worker(int _id, wstring n, WorkerType t)
-        : id(_id), name(move(n)), type(t), salary(workerBaseSalaries.at(t)), capacity(0) {
-        static const map<WorkerType, int> workerCapacities = {
-            {WORKER_VET, 20}, {WORKER_CLEANER, 3},
-            {WORKER_FEEDER, 2}, {WORKER_TRAINER, 5},
-            {WORKER_GUIDE, 0}
-        };
-        capacity = workerCapacities.at(type);
+        : id(_id), name(move(n)), type(t), salary(SpeciesCatalog::instance().worker(t).salary),
+        capacity(SpeciesCatalog::instance().worker(t).capacity) {
         if (type == WORKER_GUIDE) salary += 5000;
     }
 
 // Получение названия типа работника
 
-    wstring getTypeName() const { return workerTypeNames.at(type); }
-
-// Выполнение обязанностей работника
-
-    void performDuties(Zoo* zoo);
-
-    // Очистка вольеров
-
-    void cleanEnclosures(vector<unique_ptr<Enclosure>>& enclosures) {
-        int cleaned = 0;
-        for (auto& enclosure : enclosures) {
-            if (cleaned >= capacity) break;
-            if (!enclosure->isClean) {
-                enclosure->clean();
-                cleaned++;
-            }
-        }
-        if (cleaned > 0) {
-            wcout << name << L" почистил " << cleaned << L" вольеров." << endl;
-        }
-    }
+    const wstring& getTypeName() const { return SpeciesCatalog::instance().worker(type).name; }
 
 // Лечение животных
 
@@ -575,776 +1437,5952 @@ public:
             }
         }
         if (treated > 0) {
-            wcout << name << L" вылечил " << treated << L" животных." << endl;
+            simOut() << name << L" вылечил " << treated << L" животных." << endl;
         }
     }
 };
 
-// Класс Zoo: основной класс, управляющий зоопарком
+// Сводка персонала по типам: число работников и их суммарная производительность.
+// Системы персонала в Zoo работают по этой сводке, а не по каждому работнику отдельно
 
-class Zoo {
-private:
-    bool testMode;
-    vector<unique_ptr<Animal>> marketAnimals;
-    int marketRefreshCost;
-    time_t lastMarketRefresh;
-    int animalsBoughtToday;
-    unordered_map<int, Animal*> animalsMap;
-    unordered_map<int, Enclosure*> enclosuresMap;
-    unordered_map<int, Worker*> workersMap;
+struct StaffTotals {
+    array<int, WORKER_GUIDE + 1> count{};
+    array<int, WORKER_GUIDE + 1> capacity{};
 
-// Обновление карт для быстрого поиска объектов
+    void clear() {
+        count.fill(0);
+        capacity.fill(0);
+    }
 
-    void updateMaps() {
-        animalsMap.clear();
-        for (auto& animal : animals) {
-            animalsMap[animal->id] = animal.get();
-        }
-        enclosuresMap.clear();
-        for (auto& enclosure : enclosures) {
-            enclosuresMap[enclosure->id] = enclosure.get();
-        }
-        workersMap.clear();
-        for (auto& worker : workers) {
-            workersMap[worker->id] = worker.get();
-        }
+    void add(const Worker& worker) {
+        count[worker.type]++;
+        capacity[worker.type] += worker.capacity;
+    }
+
+// Производительность одного работника: общая делится поровну, остаток достается первым
+
+    int share(WorkerType type, int index) const {
+        return capacity[type] / count[type] + (index < capacity[type] % count[type] ? 1 : 0);
     }
+};
+
+// Статьи доходов (положительные суммы) и расходов (отрицательные) зоопарка
+
+enum LedgerCategory : uint8_t {
+    LEDGER_VISITORS, LEDGER_TOURS, LEDGER_ANIMAL_SALES, LEDGER_EXCHANGE, LEDGER_ANIMAL_PURCHASES,
+    LEDGER_ENCLOSURES, LEDGER_CLEANING, LEDGER_FOOD, LEDGER_ADVERTISING, LEDGER_MARKET, LEDGER_SALARIES,
+    LEDGER_CATEGORY_COUNT
+};
 
+const wchar_t* const ledgerCategoryNames[LEDGER_CATEGORY_COUNT] = {
+    L"Посетители", L"Экскурсии", L"Продажа животных", L"Биржа", L"Покупка животных",
+    L"Вольеры", L"Уборка", L"Корм", L"Реклама", L"Обновление рынка", L"Зарплаты"
+};
+
+// Денежный учет зоопарка в 64-битных рублях. Движения денег за день копятся в пакете
+// (сумма и число записей по каждой статье, без выделения памяти) и проводятся одним
+// commit в конце дня. Баланс для проверок учитывает и еще не проведенный пакет.
+// Суммы при переполнении упираются в границы int64 вместо смены знака
+
+class ZooLedger {
 public:
-    wstring name;
-    int money;
-    int food;
-    int popularity;
-    vector<unique_ptr<Animal>> animals;
-    vector<unique_ptr<Enclosure>> enclosures;
-    vector<unique_ptr<Worker>> workers;
-    int visitors;
-    int days;
-    int victoryDays;
-    int nextAnimalId;
-    int nextEnclosureId;
-    int nextWorkerId;
-    wstring directorName;
+    struct DayBatch {
+        array<long long, LEDGER_CATEGORY_COUNT> amount{};
+        array<uint32_t, LEDGER_CATEGORY_COUNT> entries{};
+
+        long long income() const {
+            long long total = 0;
+            for (long long value : amount) {
+                if (value > 0) total = saturatingAdd(total, value);
+            }
+            return total;
+        }
 
-// Конструктор зоопарка
+        long long expenses() const {
+            long long total = 0;
+            for (long long value : amount) {
+                if (value < 0) total = saturatingAdd(total, -value);
+            }
+            return total;
+        }
+    };
 
-    Zoo(wstring zooName, int victoryDaysCount)
-        : name(move(zooName)), money(500000), food(100), popularity(10), visitors(20),
-        days(0), victoryDays(victoryDaysCount), nextAnimalId(1), nextEnclosureId(1),
-        nextWorkerId(1), testMode(false), marketRefreshCost(5000), animalsBoughtToday(0) {
-        (void)_setmode(_fileno(stdout), _O_U16TEXT);
-        (void)_setmode(_fileno(stdin), _O_U16TEXT);
-        setlocale(LC_ALL, "ru_RU.UTF-8");
+    explicit ZooLedger(long long opening = 0) : committed(opening), pendingTotal(0) {}
 
-        directorName = safeInputString(L"Введите имя директора зоопарка: ");
-        refreshMarket();
+    static long long saturatingAdd(long long a, long long b) {
+        if (b > 0 && a > numeric_limits<long long>::max() - b) return numeric_limits<long long>::max();
+        if (b < 0 && a < numeric_limits<long long>::min() - b) return numeric_limits<long long>::min();
+        return a + b;
     }
 
-// Поиск животного по ID
+    long long balance() const { return saturatingAdd(committed, pendingTotal); }
+    bool canAfford(long long amount) const { return amount >= 0 && balance() >= amount; }
 
-    Animal* findAnimal(int id) {
-        auto it = animalsMap.find(id);
-        return it != animalsMap.end() ? it->second : nullptr;
+    void post(LedgerCategory category, long long amount) {
+        batch.amount[category] = saturatingAdd(batch.amount[category], amount);
+        batch.entries[category]++;
+        pendingTotal = saturatingAdd(pendingTotal, amount);
     }
 
-// Поиск вольера по ID
+// Проведение пакета дня: он становится итогом закрытого дня и прибавляется к итогам за всю игру
 
-    Enclosure* findEnclosure(int id) {
-        auto it = enclosuresMap.find(id);
-        return it != enclosuresMap.end() ? it->second : nullptr;
+    void commit() {
+        committed = balance();
+        for (int category = 0; category < LEDGER_CATEGORY_COUNT; category++) {
+            lifetime[category] = saturatingAdd(lifetime[category], batch.amount[category]);
+        }
+        closed = batch;
+        batch = DayBatch();
+        pendingTotal = 0;
     }
 
-// Поиск работника по ID
+// Установка баланса без истории (восстановление сохранения)
 
-    Worker* findWorker(int id) {
-        auto it = workersMap.find(id);
-        return it != workersMap.end() ? it->second : nullptr;
+    void reset(long long value) {
+        committed = value;
+        batch = DayBatch();
+        pendingTotal = 0;
     }
 
-// Обновление рынка животных
-
-    void refreshMarket() {
-        marketAnimals.clear();
-        int count = min(5 + rand() % 6, 10);
+    const DayBatch& pending() const { return batch; }
+    const DayBatch& closedDay() const { return closed; }
+    const array<long long, LEDGER_CATEGORY_COUNT>& totals() const { return lifetime; }
 
-        for (int i = 0; i < count; i++) {
-            wstring species = animalSpecies[rand() % animalSpecies.size()];
-            auto climateIt = speciesClimates.find(species);
-            if (climateIt == speciesClimates.end()) continue;
+private:
+    long long committed;
+    long long pendingTotal;
+    DayBatch batch;
+    DayBatch closed;
+    array<long long, LEDGER_CATEGORY_COUNT> lifetime{};
+};
 
-            const auto& possibleClimates = climateIt->second;
-            wstring climate = possibleClimates[rand() % possibleClimates.size()];
+// Сводные показатели зоопарка. Обновляются при каждом изменении (покупка, продажа, смерть,
+// болезнь, изменение счастья, найм), поэтому меню и расчет дня читают их за O(1).
+// Мертвые животные, еще не убранные из списка, учитываются только в deadAnimals
 
-            bool isPredator = (species == L"Лев" || species == L"Тигр" ||
-                species == L"Медведь" || species == L"Волк" ||
-                species == L"Крокодил" || species == L"Акула");
+struct ZooAggregates {
+    static const int happinessBuckets = 5;
 
-            wchar_t gender = (rand() % 2) ? 'M' : 'F';
-            int age = rand() % 5;
-            int weight = 1 + rand() % 200;
-            int price = 5000 + rand() % 45000;
+    // Часть состояния животного, от которой зависят показатели
+    struct AnimalState {
+        bool alive;
+        bool sick;
+        int happiness;
 
-            marketAnimals.push_back(make_unique<Animal>(
-                nextAnimalId++,
-                generateAnimalName(species, gender),
-                species,
-                age,
-                weight,
-                climate,
-                isPredator,
-                price,
-                gender
-            ));
+        bool operator==(const AnimalState& other) const {
+            return alive == other.alive && sick == other.sick && happiness == other.happiness;
         }
-        lastMarketRefresh = time(0);
-        wcout << L"Рынок животных обновлен! Доступно " << marketAnimals.size() << L" животных." << endl;
+    };
+
+    long long salaryTotal = 0;
+    int aliveAnimals = 0;
+    int sickAnimals = 0;
+    int deadAnimals = 0;
+    long long happinessTotal = 0;
+    array<int, happinessBuckets> happinessHistogram{};
+    vector<int> speciesPopulation;
+    vector<int> climatePopulation;
+    array<int, ENCLOSURE_PETTING_ZOO + 1> enclosureCount{};
+    array<int, ENCLOSURE_PETTING_ZOO + 1> enclosureCapacity{};
+    array<int, ENCLOSURE_PETTING_ZOO + 1> enclosureOccupancy{};
+
+    ZooAggregates() { clear(); }
+
+    void clear() {
+        salaryTotal = 0;
+        aliveAnimals = 0;
+        sickAnimals = 0;
+        deadAnimals = 0;
+        happinessTotal = 0;
+        happinessHistogram.fill(0);
+        speciesPopulation.assign(SpeciesCatalog::instance().size(), 0);
+        climatePopulation.assign(climates.size(), 0);
+        enclosureCount.fill(0);
+        enclosureCapacity.fill(0);
+        enclosureOccupancy.fill(0);
     }
 
-// Отображение главного меню
-
-    void showMainMenu() {
-        wcout << L"\n=== " << name << L" ===" << endl;
-        wcout << L"Директор: " << directorName << endl;
-        wcout << L"День: " << days << L" из " << victoryDays << endl;
-        wcout << L"Баланс: " << money << L" руб." << endl;
-        wcout << L"Еда: " << food << L" ед." << endl;
-        wcout << L"Популярность: " << popularity << endl;
-        wcout << L"Посетители сегодня: " << visitors << L" чел." << endl;
-        wcout << L"Животные: " << animals.size() << L" шт." << endl;
-        wcout << L"Вольеры: " << enclosures.size() << L" шт." << endl;
-        wcout << L"Работники: " << workers.size() << L" чел." << endl;
-
-        wcout << L"\nГлавное меню:" << endl;
-        wcout << L"1. Животные" << endl;
-        wcout << L"2. Вольеры" << endl;
-        wcout << L"3. Работники" << endl;
-        wcout << L"4. Купить еду" << endl;
-        wcout << L"5. Заказать рекламу" << endl;
-        wcout << L"6. Следующий день" << endl;
-        wcout << L"7. Показать счастье животных" << endl;
-        wcout << L"9. Выход" << endl;
+    static AnimalState stateOf(const Animal& animal) {
+        return { animal.isAlive, animal.isAlive && animal.health == AnimalHealth::SICK, animal.trueHappiness };
     }
 
-// Отображение меню животных
+// Корзина гистограммы счастья: 0-19, 20-39, 40-59, 60-79, 80-100
 
-    void showAnimalsMenu() {
-        wcout << L"\n=== Животные ===" << endl;
-        wcout << L"1. Купить животное с рынка" << endl;
-        wcout << L"2. Продать животное" << endl;
-        wcout << L"3. Просмотреть животных" << endl;
-        wcout << L"4. Обновить рынок животных (" << marketRefreshCost << L" руб.)" << endl;
-        wcout << L"5. Переименовать животное" << endl;
-        wcout << L"6. Попробовать размножить животных" << endl;
-        wcout << L"0. Назад" << endl;
-    }
+    static int happinessBucket(int happiness) { return max(0, min(happiness / 20, happinessBuckets - 1)); }
 
-// Отображение меню вольеров
+    void addAnimal(const Animal& animal) { apply(animal, stateOf(animal), 1); }
+    void removeAnimal(const Animal& animal) { apply(animal, stateOf(animal), -1); }
 
-    void showEnclosuresMenu() {
-        wcout << L"\n=== Вольеры ===" << endl;
-        wcout << L"1. Купить вольер" << endl;
-        wcout << L"2. Просмотреть вольеры" << endl;
-        wcout << L"0. Назад" << endl;
-    }
+// Учет изменения состояния животного (before - состояние до изменения)
 
-// Отображение меню работников
+    void changeAnimal(const Animal& animal, const AnimalState& before) {
+        AnimalState after = stateOf(animal);
+        if (after == before) return;
+        if (before.alive && after.alive) {
+            sickAnimals += static_cast<int>(after.sick) - static_cast<int>(before.sick);
+            happinessTotal += after.happiness - before.happiness;
+            happinessHistogram[happinessBucket(before.happiness)]--;
+            happinessHistogram[happinessBucket(after.happiness)]++;
+            return;
+        }
+        apply(animal, before, -1);
+        apply(animal, after, 1);
+    }
 
-    void showWorkersMenu() {
-        wcout << L"\n=== Работники ===" << endl;
-        wcout << L"1. Нанять работника" << endl;
-        wcout << L"2. Просмотреть работников" << endl;
-        wcout << L"0. Назад" << endl;
+    void addEnclosure(const Enclosure& enclosure) {
+        enclosureCount[enclosure.type]++;
+        enclosureCapacity[enclosure.type] += enclosure.capacity;
+        enclosureOccupancy[enclosure.type] += static_cast<int>(enclosure.containedAnimals.size());
     }
 
-// Отображение животных на рынке
+    void placeAnimal(const Enclosure& enclosure, int delta) { enclosureOccupancy[enclosure.type] += delta; }
 
-    void showMarketAnimals() {
-        wcout << L"\n=== Животные на рынке ===" << endl;
-        if (marketAnimals.empty()) {
-            wcout << L"На рынке нет животных!" << endl;
+    void addWorker(const Worker& worker) { salaryTotal += worker.salary; }
+
+    int averageHappiness() const { return aliveAnimals > 0 ? static_cast<int>(happinessTotal / aliveAnimals) : 0; }
+
+private:
+    void apply(const Animal& animal, const AnimalState& state, int sign) {
+        if (!state.alive) {
+            deadAnimals += sign;
             return;
         }
-        for (size_t i = 0; i < marketAnimals.size(); i++) {
-            const auto& animal = marketAnimals[i];
-            wcout << (i + 1) << L". " << animal->name << L" (" << (animal->gender == 'M' ? L"Самец" : L"Самка") << L")"
-                << L" | Вид: " << animal->species << L" | Возраст: " << animal->age << L" дней"
-                << L" | Вес: " << animal->weight << L" кг" << L" | Климат: " << animal->climate
-                << L" | Тип: " << animalTypes[static_cast<int>(animal->getType())]
-                << L" | " << (animal->isPredator ? L"Хищник" : L"Травоядное")
-                << L" | Цена: " << animal->price << L" руб." << endl;
+        aliveAnimals += sign;
+        if (state.sick) sickAnimals += sign;
+        happinessTotal += sign * state.happiness;
+        happinessHistogram[happinessBucket(state.happiness)] += sign;
+        if (animal.speciesId >= 0 && animal.speciesId < static_cast<int>(speciesPopulation.size())) {
+            speciesPopulation[animal.speciesId] += sign;
         }
+        auto climateIt = find(climates.begin(), climates.end(), animal.climate);
+        if (climateIt != climates.end()) climatePopulation[climateIt - climates.begin()] += sign;
     }
+};
 
-// Покупка животного с рынка
+// Столбцы истории показателей. После KPI_SPECIES_FIRST идут численности видов
+// по их ID в каталоге (KPI_SPECIES_FIRST + speciesId)
 
-    void buyAnimal() {
-        if (days > 10 && animalsBoughtToday >= 1) {
-            wcout << L"После 10 дня можно покупать только 1 животное в день!" << endl;
-            return;
-        }
-        showMarketAnimals();
-        if (marketAnimals.empty()) return;
+enum KpiColumn {
+    KPI_MONEY, KPI_FOOD, KPI_POPULARITY, KPI_VISITORS, KPI_INCOME, KPI_SALARIES,
+    KPI_HEALTHY, KPI_SICK, KPI_DEAD, KPI_AVERAGE_HAPPINESS, KPI_SPECIES_FIRST
+};
 
-        int choice = safeInputInt(L"Выберите животное для покупки (1-" + to_wstring(marketAnimals.size()) + L" или 0 для отмены): ");
-        if (choice < 1 || choice > static_cast<int>(marketAnimals.size())) return;
+enum class KpiResolution { DAY, WEEK, MONTH };
 
-        auto& animalToBuy = marketAnimals[choice - 1];
-        if (money < animalToBuy->price) {
-            wcout << L"Недостаточно денег для покупки!" << endl;
-            return;
-        }
+// Результат запроса к истории: дни (для недель и месяцев - последний день периода) и значения
 
-        bool foundEnclosure = false;
-        for (auto& enclosure : enclosures) {
-            if (enclosure->containedAnimals.size() >= static_cast<size_t>(enclosure->capacity)) {
-                continue;
-            }
-            if (enclosure->climate != animalToBuy->climate) {
-                continue;
-            }
-            if (!enclosure->isSuitableForAnimalType(animalToBuy->getType())) {
-                continue;
-            }
-            auto newAnimal = make_unique<Animal>(*animalToBuy);
-            newAnimal->id = nextAnimalId++;
-            animals.push_back(move(newAnimal));
-            enclosure->addAnimal(animals.back().get());
-            foundEnclosure = true;
-            animalsBoughtToday++;
-            money -= animalToBuy->price;
-            wcout << L"Вы купили " << animalToBuy->name << L" за " << animalToBuy->price << L" руб." << endl;
-            break;
-        }
+struct KpiSeries {
+    KpiResolution resolution = KpiResolution::DAY;
+    vector<int> days;
+    vector<double> values;
+};
 
-        if (!foundEnclosure) {
-            bool hasAquarium = false;
-            bool hasMatchingClimate = false;
-            bool hasCapacity = false;
+// Кольцевой буфер показателей, хранящий каждый столбец отдельным массивом.
+// Память растет по мере записи до capacity, дальше старые строки перезаписываются
 
-            for (auto& enclosure : enclosures) {
-                if (enclosure->type == ENCLOSURE_AQUARIUM) {
-                    hasAquarium = true;
-                    if (enclosure->climate == animalToBuy->climate) {
-                        hasMatchingClimate = true;
-                    }
-                    if (enclosure->containedAnimals.size() < static_cast<size_t>(enclosure->capacity)) {
-                        hasCapacity = true;
-                    }
-                }
-            }
+class KpiRing {
+public:
+    KpiRing(size_t columnCount, size_t capacity)
+        : capacity(capacity), head(0), count(0), columns(columnCount) {
+    }
 
-            if (!hasAquarium && animalToBuy->getType() == AnimalType::AQUATIC) {
-                wcout << L"Нет вольера типа 'Аквариум' для водного животного!" << endl;
-            }
-            else if (!hasMatchingClimate) {
-                wcout << L"Нет вольера с подходящим климатом (" << animalToBuy->climate << L")!" << endl;
-            }
-            else if (!hasCapacity) {
-                wcout << L"Все подходящие вольеры переполнены!" << endl;
-            }
-            else {
-                wcout << L"Нет подходящего вольера для этого животного!" << endl;
-            }
+    void push(int day, const vector<double>& row) {
+        if (count < capacity) {
+            days.push_back(day);
+            for (size_t c = 0; c < columns.size(); c++) columns[c].push_back(row[c]);
+            count++;
             return;
         }
-
-        updateMaps();
+        days[head] = day;
+        for (size_t c = 0; c < columns.size(); c++) columns[c][head] = row[c];
+        head = (head + 1) % capacity;
     }
 
-    void sellAnimal() {
-        if (animals.empty()) {
-            wcout << L"Нет животных для продажи!" << endl;
-            return;
-        }
-        wcout << L"\n=== Продажа животного ===" << endl;
-        wcout << L"Список животных:" << endl;
-        for (const auto& animal : animals) {
-            if (animal->getIsAlive()) {
-                wcout << L"ID:" << animal->id << L" | " << animal->name << L" | Цена: " << static_cast<int>(animal->price * 0.7) << L" руб." << endl;
-            }
-        }
+    size_t size() const { return count; }
+    int dayAt(size_t index) const { return days[physical(index)]; }
+    double valueAt(size_t column, size_t index) const { return columns[column][physical(index)]; }
 
-        int id = safeInputInt(L"Введите ID животного для продажи (0 для отмены): ");
-        if (id == 0) return;
+// Первая строка с днем не меньше заданного (дни в буфере возрастают)
 
-        auto it = find_if(animals.begin(), animals.end(), [id](const unique_ptr<Animal>& a) { return a->id == id && a->getIsAlive(); });
-        if (it == animals.end()) {
-            wcout << L"Животное с таким ID не найдено или уже мертво!" << endl;
-            return;
+    size_t lowerBound(int day) const {
+        size_t low = 0, high = count;
+        while (low < high) {
+            size_t middle = (low + high) / 2;
+            if (dayAt(middle) < day) low = middle + 1;
+            else high = middle;
         }
+        return low;
+    }
 
-        for (auto& enclosure : enclosures) {
-            enclosure->removeAnimal(id);
-        }
+    size_t memoryUsage() const {
+        size_t total = days.capacity() * sizeof(int);
+        for (const auto& column : columns) total += column.capacity() * sizeof(double);
+        return total;
+    }
 
-        int sellPrice = static_cast<int>((*it)->price * 0.7);
-        money += sellPrice;
-        animals.erase(it);
-        wcout << L"Вы продали животное за " << sellPrice << L" руб." << endl;
-        updateMaps();
+private:
+    size_t capacity;
+    size_t head;
+    size_t count;
+    vector<int> days;
+    vector<vector<double>> columns;
+
+    size_t physical(size_t index) const { return (head + index) % capacity; }
+};
+
+// История показателей зоопарка в трех разрешениях: дни, недели и месяцы.
+// Недельные и месячные точки - средние значения за период, поэтому даже
+// очень длинные прогоны занимают ограниченный объем памяти
+
+class KpiHistory {
+public:
+    static const int DAYS_PER_WEEK = 7;
+    static const int DAYS_PER_MONTH = 30;
+
+    KpiHistory(size_t columnCount, size_t dayCapacity = 365, size_t weekCapacity = 520, size_t monthCapacity = 1200)
+        : daily(columnCount, dayCapacity), weekly(columnCount, weekCapacity), monthly(columnCount, monthCapacity),
+        weekSum(columnCount, 0.0), monthSum(columnCount, 0.0), weekDays(0), monthDays(0), columnCount(columnCount) {
     }
 
-    void showAnimals() {
-        wcout << L"\n=== Список животных ===" << endl;
-        if (animals.empty()) {
-            wcout << L"Животных нет" << endl;
-            return;
-        }
-        for (const auto& animal : animals) {
-            wstring parentsInfo;
-            if (animal->getParentId1() != -1 && animal->getParentId2() != -1) {
-                parentsInfo = L" | Родители: " + to_wstring(animal->getParentId1()) + L" и " + to_wstring(animal->getParentId2());
-            }
-            wcout << L"ID:" << animal->id << L" | " << animal->name
-                << L" (" << (animal->gender == 'M' ? L"Самец" : L"Самка") << L")"
-                << L" | Вид: " << animal->species << L" | Возраст: " << animal->age << L" дней"
-                << L" | Вес: " << animal->weight << L" кг" << L" | Климат: " << animal->climate
-                << L" | Тип: " << animalTypes[static_cast<int>(animal->getType())]
-                << L" | " << (animal->isPredator ? L"Хищник" : L"Травоядное")
-                << L" | Здоровье: " << healthStatus[static_cast<int>(animal->getHealth())]
-                << L" | Цена: " << animal->price << L" руб." << parentsInfo << endl;
-        }
+    void record(int day, const vector<double>& row) {
+        daily.push(day, row);
+        accumulate(weekly, weekSum, weekDays, DAYS_PER_WEEK, day, row);
+        accumulate(monthly, monthSum, monthDays, DAYS_PER_MONTH, day, row);
     }
 
-    void renameAnimal() {
-        if (animals.empty()) {
-            wcout << L"Нет животных для переименования!" << endl;
-            return;
-        }
-        showAnimals();
-        int id = safeInputInt(L"Введите ID животного для переименования (0 для отмены): ");
-        if (id == 0) return;
+// Значения столбца за дни [fromDay, toDay] в заданном разрешении
 
-        auto animal = findAnimal(id);
-        if (!animal) {
-            wcout << L"Животное с таким ID не найдено!" << endl;
-            return;
+    KpiSeries query(int column, int fromDay, int toDay, KpiResolution resolution) const {
+        KpiSeries series;
+        series.resolution = resolution;
+        if (column < 0 || static_cast<size_t>(column) >= columnCount) return series;
+        const KpiRing& source = ring(resolution);
+        for (size_t i = source.lowerBound(fromDay); i < source.size() && source.dayAt(i) <= toDay; i++) {
+            series.days.push_back(source.dayAt(i));
+            series.values.push_back(source.valueAt(column, i));
         }
+        return series;
+    }
 
-        wcout << L"Введите новое имя для животного: ";
-        wstring newName;
-        getline(wcin, newName);
-        animal->rename(newName);
+// Запрос с автоматическим выбором самого подробного разрешения, в котором еще хранится fromDay
+
+    KpiSeries query(int column, int fromDay, int toDay) const {
+        for (KpiResolution resolution : { KpiResolution::DAY, KpiResolution::WEEK }) {
+            const KpiRing& source = ring(resolution);
+            if (source.size() > 0 && source.dayAt(0) <= fromDay) return query(column, fromDay, toDay, resolution);
+        }
+        return query(column, fromDay, toDay, KpiResolution::MONTH);
     }
 
-    void tryBreedAnimals() {
-        if (animals.size() < 2) {
-            wcout << L"Нужно как минимум 2 животных для размножения!" << endl;
-            return;
+    const KpiRing& ring(KpiResolution resolution) const {
+        switch (resolution) {
+        case KpiResolution::WEEK: return weekly;
+        case KpiResolution::MONTH: return monthly;
+        default: return daily;
         }
-        showAnimals();
-        int id1 = safeInputInt(L"Введите ID первого животного: ");
-        int id2 = safeInputInt(L"Введите ID второго животного: ");
+    }
 
+    size_t memoryUsage() const {
+        return daily.memoryUsage() + weekly.memoryUsage() + monthly.memoryUsage()
+            + (weekSum.capacity() + monthSum.capacity()) * sizeof(double);
+    }
+
+private:
+    KpiRing daily;
+    KpiRing weekly;
+    KpiRing monthly;
+    vector<double> weekSum;
+    vector<double> monthSum;
+    int weekDays;
+    int monthDays;
+    size_t columnCount;
+
+    void accumulate(KpiRing& target, vector<double>& sum, int& collected, int period, int day, const vector<double>& row) {
+        for (size_t c = 0; c < columnCount; c++) sum[c] += row[c];
+        collected++;
+        if (day % period != 0) return;
+        for (size_t c = 0; c < columnCount; c++) sum[c] /= collected;
+        target.push(day, sum);
+        fill(sum.begin(), sum.end(), 0.0);
+        collected = 0;
+    }
+};
+
+// Команды игрока для неинтерактивного управления зоопарком (хост, автоматизация)
+
+enum class ZooCommandType {
+    NEXT_DAY, BUY_ANIMAL, SELL_ANIMAL, RENAME_ANIMAL, BREED_ANIMALS, REFRESH_MARKET,
+    BUY_ENCLOSURE, HIRE_WORKER, BUY_FOOD, ADVERTISE, CLEAN_ENCLOSURE, FAST_FORWARD
+};
+
+// Параметры команды: arg1/arg2 - номер позиции, ID или вариант покупки, text - имя или климат
+
+struct ZooCommand {
+    ZooCommandType type;
+    int arg1 = 0;
+    int arg2 = 0;
+    wstring text = wstring();
+};
+
+// Итог дня модели посетителей (см. VisitorEngine)
+
+struct VisitorDayResult {
+    int visitors = 0;
+    long long spending = 0;
+    double averageSatisfaction = 0.0;
+    int popularityChange = 0;
+};
+
+// Причина остановки перемотки (см. Zoo::fastForward)
+
+enum class FastForwardStop { TARGET_DAY, ANIMAL_LOST, STAFF_LEFT, FOOD_SHORTAGE, GAME_OVER };
+
+const wchar_t* const fastForwardStopNames[] = {
+    L"достигнут целевой день", L"животное погибло или сбежало", L"работники уволились",
+    L"не хватило корма", L"игра окончена"
+};
+
+// Итог перемотки: пройдено дней, из них тихих (утро без больных, без обхода всех животных)
+
+struct FastForwardResult {
+    int days = 0;
+    int quietDays = 0;
+    FastForwardStop stop = FastForwardStop::TARGET_DAY;
+};
+
+// Итог дефрагментации животных (см. Zoo::defragmentAnimals): раздробленность до и после
+
+struct DefragmentReport {
+    size_t animals = 0;
+    double fragmentationBefore = 0.0;
+    double fragmentationAfter = 0.0;
+};
+
+// Пул строк: каждая уникальная строка хранится один раз, записи ссылаются на нее по индексу
+
+class StringPool {
+public:
+    uint32_t intern(const wstring& value) {
+        auto it = indexByValue.find(value);
+        if (it != indexByValue.end()) return it->second;
+        uint32_t index = static_cast<uint32_t>(strings.size());
+        strings.push_back(value);
+        indexByValue.emplace(value, index);
+        return index;
+    }
+
+    const wstring& at(uint32_t index) const { return strings.at(index); }
+    size_t size() const { return strings.size(); }
+
+    size_t memoryUsage() const {
+        size_t total = strings.capacity() * sizeof(wstring) + indexByValue.bucket_count() * sizeof(void*);
+        for (const auto& value : strings) {
+            total += 2 * heapBytes(value) + sizeof(pair<const wstring, uint32_t>) + 2 * sizeof(void*);
+        }
+        return total;
+    }
+
+    void clear() {
+        strings.clear();
+        indexByValue.clear();
+    }
+
+private:
+    vector<wstring> strings;
+    unordered_map<wstring, uint32_t> indexByValue;
+};
+
+// Компактная запись животного (32 байта) - только для спящих зоопарков (Zoo::hibernate):
+// живой зоопарк работает с полными объектами Animal (192 байта в ячейке AnimalSlab плюс
+// строки имени, вида и климата). Вид и климат хранятся индексами каталога,
+// стандартное имя не хранится вовсе: оно выводится из вида и пола (generateAnimalName),
+// как это делает конструктор Animal для купленных и родившихся животных.
+// Жив ли зверь, определяется по здоровью, отображаемое счастье совпадает с истинным.
+// Возраст и предельный возраст ограничены 16 битами: животное не живет дольше maxAge + 100 дней
+
+struct CompactAnimal {
+    enum Flags : uint8_t {
+        FLAG_FEMALE = 1, FLAG_PREDATOR = 2, FLAG_DISEASE = 4, FLAG_CUSTOM_NAME = 8,
+        HEALTH_SHIFT = 4, HEALTH_MASK = 3 << HEALTH_SHIFT
+    };
+
+    int32_t id;
+    int32_t weight;
+    int32_t price;
+    int32_t parentId1;
+    int32_t parentId2;
+    uint16_t age;
+    int16_t maxAge;
+    uint16_t speciesId;
+    uint16_t genome;
+    uint8_t climateId;
+    uint8_t happiness;
+    uint8_t daysSick;
+    uint8_t flags;
+
+    wchar_t gender() const { return (flags & FLAG_FEMALE) ? 'F' : 'M'; }
+    AnimalHealth health() const { return static_cast<AnimalHealth>((flags & HEALTH_MASK) >> HEALTH_SHIFT); }
+    bool isAlive() const { return health() != AnimalHealth::DEAD; }
+    bool isPredator() const { return (flags & FLAG_PREDATOR) != 0; }
+    bool hasDisease() const { return (flags & FLAG_DISEASE) != 0; }
+    bool hasCustomName() const { return (flags & FLAG_CUSTOM_NAME) != 0; }
+};
+
+static_assert(sizeof(CompactAnimal) == 32, "CompactAnimal должен занимать 32 байта");
+
+// Хранилище компактных записей животных с общим пулом пользовательских имен
+
+class CompactAnimalStore {
+public:
+    void reserve(size_t count) { records.reserve(count); }
+    size_t size() const { return records.size(); }
+    const CompactAnimal& operator[](size_t index) const { return records[index]; }
+
+    void append(const Animal& animal) {
+        CompactAnimal record;
+        record.id = animal.id;
+        record.age = static_cast<uint16_t>(max(0, min(animal.age, static_cast<int>(numeric_limits<uint16_t>::max()))));
+        record.weight = animal.weight;
+        record.price = animal.price;
+        record.parentId1 = animal.parentId1;
+        record.parentId2 = animal.parentId2;
+        record.maxAge = static_cast<int16_t>(min(animal.maxAge, static_cast<int>(numeric_limits<int16_t>::max())));
+        record.speciesId = static_cast<uint16_t>(animal.speciesId);
+        record.genome = animal.genome;
+        auto climateIt = find(climates.begin(), climates.end(), animal.climate);
+        record.climateId = static_cast<uint8_t>(climateIt - climates.begin());
+        record.happiness = static_cast<uint8_t>(max(0, min(100, animal.trueHappiness)));
+        record.daysSick = static_cast<uint8_t>(min(animal.daysSick, 255));
+        AnimalHealth health = animal.isAlive ? animal.health : AnimalHealth::DEAD;
+        record.flags = static_cast<uint8_t>(static_cast<int>(health) << CompactAnimal::HEALTH_SHIFT);
+        if (animal.gender == 'F') record.flags |= CompactAnimal::FLAG_FEMALE;
+        if (animal.isPredator) record.flags |= CompactAnimal::FLAG_PREDATOR;
+        if (animal.hasDisease) record.flags |= CompactAnimal::FLAG_DISEASE;
+        if (animal.name != generateAnimalName(animal.species, animal.gender)) {
+            record.flags |= CompactAnimal::FLAG_CUSTOM_NAME;
+            customNames[animal.id] = names.intern(animal.name);
+        }
+        records.push_back(record);
+    }
+
+// Имя животного: пользовательское из пула или стандартное, вычисленное по виду и полу
+
+    wstring nameOf(size_t index) const {
+        const CompactAnimal& record = records[index];
+        if (record.hasCustomName()) return names.at(customNames.at(record.id));
+        return generateAnimalName(SpeciesCatalog::instance().at(record.speciesId).name, record.gender());
+    }
+
+// Восстановление полноценного объекта Animal из записи
+
+    unique_ptr<Animal> materialize(size_t index) const {
+        const CompactAnimal& record = records[index];
+        const SpeciesInfo& species = SpeciesCatalog::instance().at(record.speciesId);
+        auto animal = make_unique<Animal>(record.id, wstring(), species.name, record.age, record.weight,
+            record.climateId < climates.size() ? climates[record.climateId] : climates.front(),
+            record.isPredator(), record.price, record.gender(), record.maxAge, record.parentId1, record.parentId2, record.genome);
+        if (record.hasCustomName()) animal->name = names.at(customNames.at(record.id));
+        animal->trueHappiness = record.happiness;
+        animal->displayedHappiness = record.happiness;
+        animal->health = record.health();
+        animal->isAlive = record.isAlive();
+        animal->daysSick = record.daysSick;
+        animal->hasDisease = record.hasDisease();
+        return animal;
+    }
+
+    void clear() {
+        records.clear();
+        customNames.clear();
+        names.clear();
+    }
+
+    size_t memoryUsage() const {
+        return records.capacity() * sizeof(CompactAnimal) + names.memoryUsage()
+            + customNames.bucket_count() * sizeof(void*) + customNames.size() * (sizeof(pair<const int32_t, uint32_t>) + 2 * sizeof(void*));
+    }
+
+private:
+    vector<CompactAnimal> records;
+    unordered_map<int32_t, uint32_t> customNames;
+    StringPool names;
+};
+
+// Животные "спящего" зоопарка в компактном виде вместе с составом вольеров
+
+struct HibernatedAnimals {
+    CompactAnimalStore animals;
+    CompactAnimalStore market;
+    vector<vector<uint32_t>> enclosureMembers;
+};
+
+// Карта зоопарка: сетка клеток, на которой вольеры стоят на участках 4x4,
+// окруженных дорожками. Вход - левая верхняя клетка дорожек. Участки занимаются
+// по порядку, строка за строкой, поэтому дорожки всегда образуют правильную решетку:
+// горизонтальные линии над каждым рядом и вертикальные линии между участками.
+// Расстояние по такой решетке считается по формуле за O(1) без хранения полей
+// расстояний, и память карты растет линейно с числом вольеров
+
+class ZooMap {
+public:
+    static const int lotsPerRow = 8;
+    static const int lotSize = 5;
+    static const int width = lotsPerRow * lotSize + 1;
+    static const int minutesPerCell = 2;
+
+    enum Cell : uint8_t { CELL_GRASS, CELL_PATH, CELL_ENCLOSURE };
+
+    ZooMap() {
+        cells.assign(width, CELL_GRASS);
+        cells[0] = CELL_PATH;
+    }
+
+    size_t size() const { return lots.size(); }
+    int height() const { return static_cast<int>(cells.size() / width); }
+
+// Совпадает ли карта с началом списка вольеров (вольеры только добавляются)
+
+    bool isPrefixOf(const vector<unique_ptr<Enclosure>>& enclosures) const {
+        if (lots.size() > enclosures.size()) return false;
+        for (size_t i = 0; i < lots.size(); i++) {
+            if (lots[i].enclosureId != enclosures[i]->id) return false;
+        }
+        return true;
+    }
+
+// Размещение вольера на следующем свободном участке с дорожками вокруг
+
+    void place(const Enclosure& enclosure) {
+        int lot = static_cast<int>(lots.size());
+        int left = (lot % lotsPerRow) * lotSize;
+        int top = (lot / lotsPerRow) * lotSize;
+        if (height() < top + lotSize + 1) cells.resize(static_cast<size_t>(top + lotSize + 1) * width, CELL_GRASS);
+
+        for (int i = 0; i <= lotSize; i++) {
+            cells[top * width + left + i] = CELL_PATH;
+            cells[(top + lotSize) * width + left + i] = CELL_PATH;
+            cells[(top + i) * width + left] = CELL_PATH;
+            cells[(top + i) * width + left + lotSize] = CELL_PATH;
+        }
+        pair<int, int> footprint = footprintOf(enclosure.type);
+        for (int y = 0; y < footprint.second; y++) {
+            for (int x = 0; x < footprint.first; x++) cells[(top + 1 + y) * width + left + 1 + x] = CELL_ENCLOSURE;
+        }
+
+        Lot placed;
+        placed.enclosureId = enclosure.id;
+        placed.gateX = left + 1 + footprint.first / 2;
+        placed.gateY = top;
+        lots.push_back(placed);
+    }
+
+// Расстояние по дорожкам в клетках. Входы вольеров стоят на горизонтальных линиях;
+// линии над заполненными рядами проходят во всю ширину. В одном ряду путь прямой,
+// между рядами он идет по ближайшей подходящей вертикальной линии
+
+    int distance(size_t fromLot, size_t toLot) const {
+        const Lot& from = lots[fromLot];
+        const Lot& to = lots[toLot];
+        if (from.gateY == to.gateY) return abs(from.gateX - to.gateX);
+        int detour = numeric_limits<int>::max();
+        for (int line = 0; line <= lotsPerRow; line++) {
+            int x = line * lotSize;
+            detour = min(detour, abs(from.gateX - x) + abs(to.gateX - x));
+        }
+        return abs(from.gateY - to.gateY) + detour;
+    }
+
+    int distanceFromEntrance(size_t lot) const { return lots[lot].gateX + lots[lot].gateY; }
+
+    int travelMinutes(size_t fromLot, size_t toLot) const { return distance(fromLot, toLot) * minutesPerCell; }
+    int entranceMinutes(size_t lot) const { return distanceFromEntrance(lot) * minutesPerCell; }
+
+// Строки карты: '#' - дорожка, 'E' - вход, буква - вольер (по порядку покупки), '.' - трава
+
+    vector<wstring> render() const {
+        vector<wstring> lines(height(), wstring(width, L'.'));
+        for (int y = 0; y < height(); y++) {
+            for (int x = 0; x < width; x++) {
+                uint8_t cell = cells[y * width + x];
+                if (cell == CELL_PATH) lines[y][x] = L'#';
+                else if (cell == CELL_ENCLOSURE) lines[y][x] = lotSymbol((y / lotSize) * lotsPerRow + x / lotSize);
+            }
+        }
+        lines[0][0] = L'E';
+        return lines;
+    }
+
+    static wchar_t lotSymbol(size_t lot) {
+        static const wchar_t symbols[] = L"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+        return symbols[lot % (sizeof(symbols) / sizeof(wchar_t) - 1)];
+    }
+
+    size_t memoryUsage() const { return sizeof(ZooMap) + cells.capacity() + lots.capacity() * sizeof(Lot); }
+
+private:
+    struct Lot {
+        int enclosureId;
+        int gateX;
+        int gateY;
+    };
+
+    vector<uint8_t> cells;
+    vector<Lot> lots;
+
+    static pair<int, int> footprintOf(EnclosureType type) {
+        switch (type) {
+        case ENCLOSURE_SMALL: return { 2, 2 };
+        case ENCLOSURE_MEDIUM: return { 3, 3 };
+        case ENCLOSURE_LARGE: return { 4, 3 };
+        case ENCLOSURE_HUGE: return { 4, 4 };
+        case ENCLOSURE_AQUARIUM: return { 3, 2 };
+        case ENCLOSURE_BIRD_CAGE: return { 2, 3 };
+        case ENCLOSURE_REPTILE_HOUSE: return { 3, 2 };
+        default: return { 3, 3 };
+        }
+    }
+};
+
+// Маршрут работника за смену: выходит от входа, обходит вольеры и должен успеть вернуться.
+// Участок -1 - сам вход. Переходы между вольерами записываются в contacts (работник переносит болезни)
+
+class StaffRoute {
+public:
+    static const int shiftMinutes = 480;
+    static const int cleaningMinutes = 90;
+    static const int examMinutes = 15;
+
+    explicit StaffRoute(const ZooMap& zooMap, vector<pair<int, int>>* contacts = nullptr)
+        : map(zooMap), contacts(contacts), position(-1), minutes(0) {
+    }
+
+    int minutesBetween(int fromLot, int toLot) const {
+        if (fromLot < 0 && toLot < 0) return 0;
+        if (fromLot < 0) return map.entranceMinutes(toLot);
+        if (toLot < 0) return map.entranceMinutes(fromLot);
+        return map.travelMinutes(fromLot, toLot);
+    }
+
+    int minutesTo(int lot) const { return minutesBetween(position, lot); }
+
+// Переход к участку и до maxJobs работ по jobMinutes. Возвращает число работ,
+// которые успеваются с учетом дороги обратно (0 - работник туда не идет)
+
+    int visit(int lot, int jobMinutes, int maxJobs) {
+        int arrival = minutes + minutesTo(lot);
+        int jobs = min(maxJobs, (shiftMinutes - arrival - minutesBetween(lot, -1)) / jobMinutes);
+        if (jobs <= 0) return 0;
+        if (contacts && position >= 0 && lot >= 0) contacts->emplace_back(position, lot);
+        minutes = arrival + jobs * jobMinutes;
+        position = lot;
+        return jobs;
+    }
+
+    int usedMinutes() const { return minutes; }
+
+private:
+    const ZooMap& map;
+    vector<pair<int, int>>* contacts;
+    int position;
+    int minutes;
+};
+
+// Распределение задач персонала одного типа на день. Задачи выбираются по убыванию приоритета
+// из кучи, очередную получает работник с наибольшим запасом времени смены (вторая куча).
+// Задача, до которой никто не успевает дойти и вернуться, остается на завтра.
+// Весь проход стоит O(E log E + E log W) для E задач и W работников
+
+class StaffAssignment {
+public:
+    StaffAssignment(const ZooMap& zooMap, vector<pair<int, int>>* contacts, const StaffTotals& staff,
+        WorkerType type, int jobMinutes)
+        : jobMinutes(jobMinutes) {
+        int count = staff.count[type];
+        routes.reserve(count);
+        for (int i = 0; i < count; i++) {
+            routes.emplace_back(zooMap, contacts);
+            int jobs = staff.share(type, i);
+            if (jobs > 0) workers.push({ StaffRoute::shiftMinutes, jobs, i });
+        }
+    }
+
+// Задача: участок lot (-1 - вход), jobs однотипных работ, tag - номер у вызывающего.
+// Из задач с равным приоритетом раньше выполняется добавленная раньше
+
+    void add(long long priority, int lot, int jobs, int tag) {
+        if (jobs > 0) tasks.push({ priority, sequence++, lot, jobs, tag });
+    }
+
+// Следующее назначение: номер задачи и число выполненных работ. false, когда задачи
+// или рабочее время кончились
+
+    bool next(int& tag, int& jobs) {
+        while (!tasks.empty() && !workers.empty()) {
+            Task task = tasks.top();
+            tasks.pop();
+            Slot worker = workers.top();
+            workers.pop();
+            StaffRoute& route = routes[worker.index];
+            int done = route.visit(task.lot, jobMinutes, min(task.jobs, worker.jobsLeft));
+            worker.jobsLeft -= done;
+            worker.minutesLeft = StaffRoute::shiftMinutes - route.usedMinutes();
+            if (worker.jobsLeft > 0 && worker.minutesLeft >= jobMinutes) workers.push(worker);
+            if (done == 0) continue;
+            tag = task.tag;
+            jobs = done;
+            return true;
+        }
+        return false;
+    }
+
+private:
+    struct Task {
+        long long priority;
+        size_t sequence;
+        int lot;
+        int jobs;
+        int tag;
+
+        bool operator<(const Task& other) const {
+            return priority != other.priority ? priority < other.priority : sequence > other.sequence;
+        }
+    };
+
+    struct Slot {
+        int minutesLeft;
+        int jobsLeft;
+        int index;
+
+        bool operator<(const Slot& other) const {
+            if (minutesLeft != other.minutesLeft) return minutesLeft < other.minutesLeft;
+            if (jobsLeft != other.jobsLeft) return jobsLeft < other.jobsLeft;
+            return index > other.index;
+        }
+    };
+
+    int jobMinutes;
+    size_t sequence = 0;
+    vector<StaffRoute> routes;
+    priority_queue<Task> tasks;
+    priority_queue<Slot> workers;
+};
+
+// Планировщик смены по тикам. Задача работника - возобновляемая функция без своего стека
+// (конечный автомат ShiftTask): resume продолжает ее с места остановки и возвращает минуту,
+// до которой она ждет, или finished. Ждущие задачи лежат в куче по минуте пробуждения,
+// и на каждом тике возобновляются только те, чье ожидание истекло. Ожидание стоит записи
+// в куче и состояния задачи в несколько десятков байт, поэтому тысячи работников
+// чередуются в одном потоке
+
+class ShiftScheduler {
+public:
+    static const int finished = -1;
+
+    explicit ShiftScheduler(int tickMinutes) : tickMinutes(max(1, tickMinutes)), tickCount(0), resumeCount(0) {}
+
+    void start(uint32_t task, int wake) { waiting.push({ wake, task }); }
+
+// Тики идут, пока есть ждущие задачи. Задача, проснувшаяся внутри тика, продолжается в начале
+// следующего: время в смене квантуется тиком. Среди проснувшихся первой идет та, что ждала
+// до более ранней минуты (при равенстве - с меньшим номером)
+
+    template <typename Resume>
+    void run(Resume resume) {
+        for (int tick = 0; !waiting.empty(); tick += tickMinutes) {
+            tickCount++;
+            while (!waiting.empty() && waiting.top().wake <= tick) {
+                Wait wait = waiting.top();
+                waiting.pop();
+                resumeCount++;
+                int next = resume(wait.task, tick);
+                if (next != finished) waiting.push({ next, wait.task });
+            }
+        }
+    }
+
+    long long ticks() const { return tickCount; }
+    long long resumes() const { return resumeCount; }
+
+private:
+    struct Wait {
+        int wake;
+        uint32_t task;
+
+        bool operator<(const Wait& other) const {
+            return wake != other.wake ? wake > other.wake : task > other.task;
+        }
+    };
+
+    int tickMinutes;
+    long long tickCount;
+    long long resumeCount;
+    priority_queue<Wait> waiting;
+};
+
+// Состояние работника в смене по тикам: где он, что делает и сколько еще может сделать
+
+struct ShiftTask {
+    enum Step : uint8_t { STEP_CHOOSE, STEP_WORK, STEP_RETURN };
+
+    WorkerType type;
+    Step step;
+    // Текущий участок (-1 - вход) и работа на нем: номер вольера или палаты ветеринара
+    int lot;
+    int job;
+    // Производительность на остаток смены и работы, оставшиеся на текущем участке
+    int jobsLeft;
+    int jobsHere;
+};
+
+// Граф контактов между вольерами в сжатом построчном виде (CSR): соседние участки карты
+// и общий водопровод аквариумов одного ряда участков. Вес ребра - доля болезни соседа,
+// которая переходит в вольер. Ребер O(число вольеров), поэтому давление инфекции
+// считается за один проход по ребрам даже для сотен тысяч вольеров
+
+class ContactGraph {
+public:
+    static constexpr float neighbourWeight = 0.2f;
+    static constexpr float waterWeight = 0.5f;
+    static constexpr float keeperWeight = 0.3f;
+
+    explicit ContactGraph(const vector<unique_ptr<Enclosure>>& enclosures) {
+        size_t count = enclosures.size();
+        int perRow = ZooMap::lotsPerRow;
+        rowStart.reserve(count + 1);
+        columns.reserve(count * 4);
+        weights.reserve(count * 4);
+        rowStart.push_back(0);
+        for (size_t lot = 0; lot < count; lot++) {
+            size_t column = lot % perRow;
+            if (lot >= static_cast<size_t>(perRow)) addEdge(lot - perRow, neighbourWeight);
+            if (column > 0) addEdge(lot - 1, neighbourWeight);
+            if (column + 1 < static_cast<size_t>(perRow) && lot + 1 < count) addEdge(lot + 1, neighbourWeight);
+            if (lot + perRow < count) addEdge(lot + perRow, neighbourWeight);
+
+            if (enclosures[lot]->type == ENCLOSURE_AQUARIUM) {
+                size_t rowFirst = lot - column;
+                for (size_t other = rowFirst; other < min(rowFirst + perRow, count); other++) {
+                    if (other != lot && enclosures[other]->type == ENCLOSURE_AQUARIUM) addEdge(other, waterWeight);
+                }
+            }
+            rowStart.push_back(static_cast<uint32_t>(columns.size()));
+        }
+    }
+
+    size_t nodeCount() const { return rowStart.size() - 1; }
+    size_t edgeCount() const { return columns.size(); }
+
+// pressure = A * source: давление на вольер - взвешенная сумма доли больных у соседей
+
+    void spread(const vector<float>& source, vector<float>& pressure) const {
+        size_t count = nodeCount();
+        pressure.resize(count);
+        for (size_t row = 0; row < count; row++) {
+            float sum = 0.0f;
+            for (uint32_t edge = rowStart[row]; edge < rowStart[row + 1]; edge++) sum += weights[edge] * source[columns[edge]];
+            pressure[row] = sum;
+        }
+    }
+
+    size_t memoryUsage() const {
+        return sizeof(ContactGraph) + rowStart.capacity() * sizeof(uint32_t) + columns.capacity() * sizeof(uint32_t)
+            + weights.capacity() * sizeof(float);
+    }
+
+private:
+    vector<uint32_t> rowStart;
+    vector<uint32_t> columns;
+    vector<float> weights;
+
+    void addEdge(size_t column, float weight) {
+        columns.push_back(static_cast<uint32_t>(column));
+        weights.push_back(weight);
+    }
+};
+
+// Сущности зоопарка, общие для нескольких веток симуляции до первого обращения.
+// Объекты внутри снимка не изменяются, пока на него ссылается больше одной ветки
+
+struct ZooEntities {
+    vector<unique_ptr<Animal>> animals;
+    vector<unique_ptr<Enclosure>> enclosures;
+    vector<unique_ptr<Worker>> workers;
+    vector<unique_ptr<Animal>> marketAnimals;
+    unordered_map<int, Animal*> animalsMap;
+    unordered_map<int, Enclosure*> enclosuresMap;
+    unordered_map<int, Worker*> workersMap;
+};
+
+// Готовые сущности для Zoo::bulkInsert. Животные уже заселены в вольеры партии через
+// Enclosure::attach (или живут вне вольеров, если home == nullptr)
+
+struct EntityBatch {
+    vector<unique_ptr<Enclosure>> enclosures;
+    vector<unique_ptr<Animal>> animals;
+    vector<unique_ptr<Worker>> workers;
+};
+
+// Класс Zoo: основной класс, управляющий зоопарком
+
+class Zoo {
+private:
+    bool testMode;
+    vector<unique_ptr<Animal>> marketAnimals;
+    int marketRefreshCost;
+    time_t lastMarketRefresh;
+    int animalsBoughtToday;
+    bool gameOver;
+    vector<double> kpiRow;
+    vector<ZooAggregates::AnimalState> stateScratch;
+    array<bool, FOOD_TYPE_COUNT> dietFed;
+    // Какие типы корма были в достатке при прошлом пересчете счастья (бит на тип)
+    uint8_t happinessFedMask = 0;
+    // Длина тика смены персонала в минутах (0 - уборка и осмотры рассчитываются за день одним проходом)
+    int shiftTickMinutes = 0;
+    // Ветка, созданная fork(): живет недолго, хранилище животных не обслуживает
+    bool isBranch = false;
+    shared_ptr<ZooEntities> sharedEntities;
+    ZooJournal* journal;
+    shared_ptr<VisitorEngine> visitorEngine;
+    vector<float> visitorAttraction;
+    shared_ptr<ZooMap> layout;
+    shared_ptr<const ContactGraph> contactGraph;
+    vector<pair<int, int>> keeperContacts;
+    vector<float> infectionSource;
+    vector<float> infectionPressure;
+    unique_ptr<HibernatedAnimals> hibernated;
+
+    friend class ZooJournal;
+    unordered_map<int, Animal*> animalsMap;
+    unordered_map<int, Enclosure*> enclosuresMap;
+    unordered_map<int, Worker*> workersMap;
+
+// Обновление карт для быстрого поиска объектов
+
+    void updateMaps() {
+        aggregates.clear();
+        animalsMap.clear();
+        for (auto& animal : animals) {
+            animalsMap[animal->id] = animal.get();
+            aggregates.addAnimal(*animal);
+        }
+        enclosuresMap.clear();
+        for (auto& enclosure : enclosures) {
+            enclosuresMap[enclosure->id] = enclosure.get();
+            aggregates.addEnclosure(*enclosure);
+        }
+        workersMap.clear();
+        staff.clear();
+        for (auto& worker : workers) {
+            workersMap[worker->id] = worker.get();
+            staff.add(*worker);
+            aggregates.addWorker(*worker);
+        }
+        syncLayout();
+    }
+
+// Карта следует за списком вольеров: новые вольеры достраиваются, при расхождении
+// (загрузка другого сохранения) карта строится заново. Общая с веткой карта копируется
+
+    void syncLayout() {
+        if (!layout->isPrefixOf(enclosures)) {
+            layout = make_shared<ZooMap>();
+            keeperContacts.clear();
+        }
+        if (layout->size() == enclosures.size()) return;
+        contactGraph.reset();
+        if (layout.use_count() > 1) layout = make_shared<ZooMap>(*layout);
+        for (size_t i = layout->size(); i < enclosures.size(); i++) layout->place(*enclosures[i]);
+    }
+
+// Пошаговое обновление карт и сводки при добавлении и удалении сущностей
+// (updateMaps пересобирает их целиком после массовых изменений)
+
+    void registerAnimal(Animal* animal) {
+        animalsMap[animal->id] = animal;
+        aggregates.addAnimal(*animal);
+    }
+
+    bool placeAnimal(Enclosure& enclosure, Animal* animal) {
+        if (!enclosure.addAnimal(animal)) return false;
+        aggregates.placeAnimal(enclosure, 1);
+        return true;
+    }
+
+// Удаление животного из вольеров, карты и сводки (сам объект удаляет вызывающий)
+
+    void forgetAnimal(const Animal& animal) {
+        for (auto& enclosure : enclosures) {
+            if (enclosure->removeAnimal(animal.id)) aggregates.placeAnimal(*enclosure, -1);
+        }
+        aggregates.removeAnimal(animal);
+        animalsMap.erase(animal.id);
+    }
+
+// Перенос болезни между вольерами: доля больных в каждом вольере умножается на граф контактов,
+// к ней добавляются вчерашние переходы уборщиков и ветеринаров между вольерами.
+// Здоровое животное заражается с вероятностью давление * 20% (как внутри вольера)
+
+    void runContagionSystem() {
+        vector<pair<int, int>> contacts = move(keeperContacts);
+        keeperContacts.clear();
+        if (aggregates.sickAnimals == 0 || enclosures.size() < 2) return;
+        if (!contactGraph) contactGraph = make_shared<const ContactGraph>(enclosures);
+
+        infectionSource.assign(enclosures.size(), 0.0f);
+        bool anySource = false;
+        for (size_t i = 0; i < enclosures.size(); i++) {
+            int alive = 0;
+            int sick = 0;
+            for (auto animal : enclosures[i]->containedAnimals) {
+                alive += animal->isAlive;
+                sick += animal->isAlive && animal->health == AnimalHealth::SICK;
+            }
+            if (sick == 0) continue;
+            infectionSource[i] = static_cast<float>(sick) / alive;
+            anySource = true;
+        }
+        if (!anySource) return;
+
+        contactGraph->spread(infectionSource, infectionPressure);
+        for (const auto& contact : contacts) {
+            infectionPressure[contact.second] += ContactGraph::keeperWeight * infectionSource[contact.first];
+            infectionPressure[contact.first] += ContactGraph::keeperWeight * infectionSource[contact.second];
+        }
+
+        int infected = 0;
+        for (size_t i = 0; i < enclosures.size(); i++) {
+            if (infectionPressure[i] <= 0.0f) continue;
+            int chance = static_cast<int>(lround(min(1.0f, infectionPressure[i]) * 200.0f));
+            for (auto animal : enclosures[i]->containedAnimals) {
+                if (animal->health != AnimalHealth::HEALTHY || simRand() % 1000 >= chance) continue;
+                ZooAggregates::AnimalState before = ZooAggregates::stateOf(*animal);
+                if (animal->infect()) {
+                    infected++;
+                    enclosures[i]->happinessDirty = true;
+                }
+                aggregates.changeAnimal(*animal, before);
+            }
+        }
+        if (infected > 0) {
+            simOut() << L"Болезнь перешла из соседних вольеров: заболело животных: " << infected << L"." << endl;
+        }
+    }
+
+// Системы персонала: каждая обрабатывает всех работников своего типа за один проход.
+// Работа распределяется по приоритетам (см. StaffAssignment), а не по порядку вольеров
+
+// Приоритет уборки: сколько счастья грязь отнимет у живых жильцов (до 20 у каждого).
+// Счастье не восстанавливается, поэтому в первую очередь сохраняется то, что еще есть
+
+    static long long cleaningPriority(const Enclosure& enclosure) {
+        long long priority = 0;
+        for (auto animal : enclosure.containedAnimals) {
+            if (animal->isAlive) priority += min(20, animal->trueHappiness);
+        }
+        return priority;
+    }
+
+// Приоритет осмотра больного: после 5 дней болезни животное может умереть
+
+    static long long patientPriority(const Animal& animal) {
+        return 100 + 30 * min(animal.daysSick, 5) + (100 - animal.trueHappiness) / 2;
+    }
+
+    void runCleaningSystem() {
+        int cleaners = staff.count[WORKER_CLEANER];
+        if (cleaners == 0) return;
+        StaffAssignment assignment(*layout, &keeperContacts, staff, WORKER_CLEANER, StaffRoute::cleaningMinutes);
+        // При равном приоритете раньше идет тот, кто раньше добавлен; начало обхода сдвигается
+        // каждый день, чтобы ни один вольер не оставался последним постоянно
+        size_t count = enclosures.size();
+        for (size_t k = 0; k < count; k++) {
+            size_t i = (k + static_cast<size_t>(days)) % count;
+            if (!enclosures[i]->isClean) assignment.add(cleaningPriority(*enclosures[i]), static_cast<int>(i), 1, static_cast<int>(i));
+        }
+        int cleaned = 0;
+        int target = 0;
+        int jobs = 0;
+        while (assignment.next(target, jobs)) {
+            enclosures[target]->clean();
+            cleaned++;
+        }
+        if (cleaned > 0) {
+            simOut() << L"Уборщики (" << cleaners << L") почистили " << cleaned << L" вольеров." << endl;
+        }
+    }
+
+// Палата ветеринара: участок (-1 - вход), сколько раз ее уже обходили и больные в ней
+
+    struct Ward {
+        int lot;
+        int rounds;
+        vector<Animal*> patients;
+
+        long long priority() const {
+            long long total = 0;
+            for (auto animal : patients) total += patientPriority(*animal);
+            return total;
+        }
+    };
+
+// Палаты ветеринаров: больные у входа (палата 0, участок -1) и в каждом вольере с больными,
+// в каждой палате самые тяжелые больные идут первыми
+
+    vector<Ward> collectWards() {
+        vector<Ward> wards(1, Ward{ -1, 0, {} });
+        if (aggregates.sickAnimals == 0) return wards;
+        int housedSick = 0;
+        for (size_t i = 0; i < enclosures.size(); i++) {
+            Ward ward{ static_cast<int>(i), 0, {} };
+            for (auto animal : enclosures[i]->containedAnimals) {
+                if (animal->isAlive && animal->health == AnimalHealth::SICK) ward.patients.push_back(animal);
+            }
+            housedSick += static_cast<int>(ward.patients.size());
+            if (!ward.patients.empty()) wards.push_back(move(ward));
+        }
+        if (housedSick < aggregates.sickAnimals) {
+            unordered_set<const Animal*> housed;
+            for (size_t w = 1; w < wards.size(); w++) housed.insert(wards[w].patients.begin(), wards[w].patients.end());
+            for (auto& animal : animals) {
+                if (animal->isAlive && animal->health == AnimalHealth::SICK && !housed.count(animal.get())) {
+                    wards[0].patients.push_back(animal.get());
+                }
+            }
+        }
+        for (auto& ward : wards) {
+            sort(ward.patients.begin(), ward.patients.end(), [](const Animal* a, const Animal* b) {
+                return patientPriority(*a) > patientPriority(*b);
+            });
+        }
+        return wards;
+    }
+
+// Осмотр больного: вылечивает с вероятностью 70%
+
+    bool examinePatient(Animal* animal) {
+        if (simRand() % 100 >= 70) return false;
+        ZooAggregates::AnimalState before = ZooAggregates::stateOf(*animal);
+        animal->health = AnimalHealth::HEALTHY;
+        animal->hasDisease = false;
+        animal->daysSick = 0;
+        if (animal->home) animal->home->happinessDirty = true;
+        aggregates.changeAnimal(*animal, before);
+        return true;
+    }
+
+// Ветеринары: больные вне вольеров осматриваются у входа, остальные в своих вольерах.
+// Первыми осматриваются самые тяжелые больные самых тяжелых вольеров. Осмотр вылечивает
+// с вероятностью 70%, невылеченные возвращаются в очередь с новым приоритетом (не больше
+// одного раза на ветеринара). Осмотры ограничены производительностью и сменой с учетом дороги
+
+    void runVeterinarySystem() {
+        int vets = staff.count[WORKER_VET];
+        if (vets == 0) return;
+        vector<Ward> wards = collectWards();
+
+        StaffAssignment assignment(*layout, &keeperContacts, staff, WORKER_VET, StaffRoute::examMinutes);
+        auto schedule = [&](int w) {
+            assignment.add(wards[w].priority(), wards[w].lot, static_cast<int>(wards[w].patients.size()), w);
+        };
+        for (size_t w = 0; w < wards.size(); w++) schedule(static_cast<int>(w));
+
+        int examined = 0;
+        int cured = 0;
+        int ward = 0;
+        int count = 0;
+        while (assignment.next(ward, count)) {
+            vector<Animal*>& patients = wards[ward].patients;
+            examined += count;
+            vector<Animal*> remaining(patients.begin() + count, patients.end());
+            for (int i = 0; i < count; i++) {
+                if (examinePatient(patients[i])) cured++;
+                else remaining.push_back(patients[i]);
+            }
+            patients = move(remaining);
+            if (!patients.empty() && ++wards[ward].rounds < vets) schedule(ward);
+        }
+        simOut() << L"Ветеринары (" << vets << L") осмотрели больных: " << examined << L", вылечили: " << cured << L"." << endl;
+    }
+
+// Смена уборщиков и ветеринаров по тикам (режим shiftTickMinutes > 0). Каждый работник -
+// задача ShiftScheduler: берет самую срочную работу из общей очереди (грязные вольеры или
+// палаты), идет к участку, выполняет работы по одной и берет следующую. Работа, до которой
+// он не успевает дойти и вернуться ко входу до конца смены, остается на завтра. Уборка
+// и вылеченный больной вступают в силу в минуту окончания работы, поэтому вольер,
+// освободившийся у одного работника, сразу может взять другой
+
+    void runStaffShift() {
+        int cleaners = staff.count[WORKER_CLEANER];
+        int vets = staff.count[WORKER_VET];
+        if (cleaners == 0 && vets == 0) return;
+
+        struct Job {
+            long long priority;
+            size_t sequence;
+            int index;
+
+            bool operator<(const Job& other) const {
+                return priority != other.priority ? priority < other.priority : sequence > other.sequence;
+            }
+        };
+        size_t sequence = 0;
+        priority_queue<Job> dirty;
+        priority_queue<Job> sickWards;
+        size_t count = enclosures.size();
+        for (size_t k = 0; cleaners > 0 && k < count; k++) {
+            size_t i = (k + static_cast<size_t>(days)) % count;
+            if (!enclosures[i]->isClean) dirty.push({ cleaningPriority(*enclosures[i]), sequence++, static_cast<int>(i) });
+        }
+        vector<Ward> wards;
+        if (vets > 0) wards = collectWards();
+        for (size_t w = 0; w < wards.size(); w++) {
+            if (!wards[w].patients.empty()) sickWards.push({ wards[w].priority(), sequence++, static_cast<int>(w) });
+        }
+
+        vector<ShiftTask> tasks;
+        for (WorkerType type : { WORKER_CLEANER, WORKER_VET }) {
+            for (int i = 0; i < staff.count[type]; i++) {
+                int jobs = staff.share(type, i);
+                if (jobs > 0) tasks.push_back({ type, ShiftTask::STEP_CHOOSE, -1, -1, jobs, 0 });
+            }
+        }
+        ShiftScheduler scheduler(shiftTickMinutes);
+        for (size_t i = 0; i < tasks.size(); i++) scheduler.start(static_cast<uint32_t>(i), 0);
+
+        StaffRoute route(*layout);
+        int cleaned = 0;
+        int examined = 0;
+        int cured = 0;
+        // Палату обходит один ветеринар за раз: сколько больных он уже осмотрел и кто не вылечен
+        vector<size_t> cursor(wards.size(), 0);
+        vector<vector<Animal*>> deferred(wards.size());
+        scheduler.run([&](uint32_t id, int now) {
+            ShiftTask& task = tasks[id];
+            bool cleaner = task.type == WORKER_CLEANER;
+            int jobMinutes = cleaner ? StaffRoute::cleaningMinutes : StaffRoute::examMinutes;
+            switch (task.step) {
+            case ShiftTask::STEP_WORK:
+                task.jobsLeft--;
+                task.jobsHere--;
+                if (cleaner) {
+                    enclosures[task.job]->clean();
+                    cleaned++;
+                }
+                else {
+                    Animal* patient = wards[task.job].patients[cursor[task.job]++];
+                    examined++;
+                    if (examinePatient(patient)) cured++;
+                    else deferred[task.job].push_back(patient);
+                }
+                if (task.jobsHere > 0) return now + jobMinutes;
+                if (!cleaner) {
+                    // Невылеченные возвращаются в конец палаты, палата - в очередь (не больше раза на ветеринара)
+                    Ward& ward = wards[task.job];
+                    ward.patients.erase(ward.patients.begin(), ward.patients.begin() + cursor[task.job]);
+                    ward.patients.insert(ward.patients.end(), deferred[task.job].begin(), deferred[task.job].end());
+                    deferred[task.job].clear();
+                    cursor[task.job] = 0;
+                    if (!ward.patients.empty() && ++ward.rounds < vets) sickWards.push({ ward.priority(), sequence++, task.job });
+                }
+                task.step = ShiftTask::STEP_CHOOSE;
+                [[fallthrough]];
+            case ShiftTask::STEP_CHOOSE: {
+                priority_queue<Job>& queue = cleaner ? dirty : sickWards;
+                while (task.jobsLeft > 0 && !queue.empty()) {
+                    Job job = queue.top();
+                    queue.pop();
+                    int lot = cleaner ? job.index : wards[job.index].lot;
+                    int available = cleaner ? 1 : static_cast<int>(wards[job.index].patients.size());
+                    int arrival = now + route.minutesBetween(task.lot, lot);
+                    int jobs = min(min(task.jobsLeft, available),
+                        (StaffRoute::shiftMinutes - arrival - route.minutesBetween(lot, -1)) / jobMinutes);
+                    if (jobs <= 0) continue;
+                    if (task.lot >= 0 && lot >= 0) keeperContacts.emplace_back(task.lot, lot);
+                    task.lot = lot;
+                    task.job = job.index;
+                    task.jobsHere = jobs;
+                    task.step = ShiftTask::STEP_WORK;
+                    return arrival + jobMinutes;
+                }
+                if (task.lot < 0) return ShiftScheduler::finished;
+                task.step = ShiftTask::STEP_RETURN;
+                int back = now + route.minutesBetween(task.lot, -1);
+                task.lot = -1;
+                return back;
+            }
+            case ShiftTask::STEP_RETURN:
+                break;
+            }
+            return ShiftScheduler::finished;
+        });
+
+        if (cleaned > 0) {
+            simOut() << L"Уборщики (" << cleaners << L") почистили " << cleaned << L" вольеров." << endl;
+        }
+        if (vets > 0) {
+            simOut() << L"Ветеринары (" << vets << L") осмотрели больных: " << examined << L", вылечили: " << cured << L"." << endl;
+        }
+        simOut() << L"Смена персонала: " << scheduler.ticks() << L" тиков по " << shiftTickMinutes << L" мин, "
+            << scheduler.resumes() << L" возобновлений задач." << endl;
+    }
+
+// Кормление: дневная потребность каждого типа корма считается по численности видов,
+// корм списывается один раз в день. Без кормильщиков четверть корма пропадает,
+// каждая единица их производительности сокращает потери на 5%
+
+    void runFeedingSystem() {
+        array<int, FOOD_TYPE_COUNT> need = dailyFoodNeed();
+        int feeders = staff.count[WORKER_FEEDER];
+        int wastePercent = max(0, 25 - 5 * staff.capacity[WORKER_FEEDER]);
+        for (int type = 0; type < FOOD_TYPE_COUNT; type++) {
+            dietFed[type] = true;
+            if (need[type] == 0) continue;
+            int portion = need[type] + (need[type] * wastePercent + 99) / 100;
+            if (foodStock[type] >= portion) {
+                foodStock[type] -= portion;
+                continue;
+            }
+            foodStock[type] = 0;
+            dietFed[type] = false;
+            simOut() << L"Предупреждение: не хватает корма (" << foodTypeNames[type] << L") для всех животных!" << endl;
+        }
+        if (aggregates.aliveAnimals > 0) {
+            simOut() << L"Животные накормлены" << (feeders > 0 ? L" кормильщиками (" + to_wstring(feeders) + L")" : L"")
+                << L". Остаток корма: мясо " << foodStock[FOOD_MEAT] << L", рыба " << foodStock[FOOD_FISH]
+                << L", растительный " << foodStock[FOOD_PLANTS] << L" ед." << endl;
+        }
+    }
+
+// Счастье: сыто ли животное, зависит от запаса его корма. Счастье только убывает, поэтому
+// вольер, где при прошлом пересчете ни у кого оно не изменилось, при тех же входах
+// (состав, чистота, болезни, корм) не изменится и сегодня - такой вольер пропускается.
+// Вольеры с изменившимися входами или продолжающимся падением счастья пересчитываются
+
+    void runHappinessSystem() {
+        uint8_t fedMask = 0;
+        for (int type = 0; type < FOOD_TYPE_COUNT; type++) {
+            if (dietFed[type]) fedMask |= static_cast<uint8_t>(1u << type);
+        }
+        if (fedMask != happinessFedMask) {
+            for (auto& enclosure : enclosures) enclosure->happinessDirty = true;
+            happinessFedMask = fedMask;
+        }
+
+        const SpeciesCatalog& catalog = SpeciesCatalog::instance();
+        for (auto& enclosure : enclosures) {
+            if (!enclosure->happinessDirty) continue;
+            bool isAlone = enclosure->containedAnimals.size() == 1;
+            bool changed = false;
+            for (auto animal : enclosure->containedAnimals) {
+                ZooAggregates::AnimalState before = ZooAggregates::stateOf(*animal);
+                bool isFed = dietFed[catalog.at(animal->speciesId).diet];
+                animal->updateHappiness(isFed, isAlone, enclosure->isClean);
+                if (animal->trueHappiness != before.happiness) changed = true;
+                aggregates.changeAnimal(*animal, before);
+            }
+            enclosure->happinessDirty = changed;
+        }
+    }
+
+    void runVisitorSystem() {
+        int trainers = staff.count[WORKER_TRAINER];
+        int guides = staff.count[WORKER_GUIDE];
+        if (trainers > 0) {
+            popularity += 2 * trainers;
+            simOut() << L"Дрессировщики (" << trainers << L") провели дрессировки. Популярность +" << 2 * trainers << L"." << endl;
+        }
+        if (guides > 0) {
+            long long tourIncome = 100LL * guides * visitors;
+            popularity += 3 * guides;
+            ledger.post(LEDGER_TOURS, tourIncome);
+            simOut() << L"Экскурсоводы (" << guides << L") провели экскурсии. Популярность +" << 3 * guides
+                << L", доход " << tourIncome << L" руб." << endl;
+        }
+    }
+
+// Начало дня: счетчик дней и дневные ограничения
+
+    void beginDay() {
+        days++;
+        animalsBoughtToday = 0;
+        simOut() << L"\n=== День " << days << L" ===" << endl;
+    }
+
+// Обновление возраста и проверка здоровья животных
+
+    void ageAnimals() {
+        for (auto it = animals.begin(); it != animals.end(); ) {
+            ZooAggregates::AnimalState before = ZooAggregates::stateOf(**it);
+            (*it)->age++;
+            (*it)->checkDisease();
+            bool diedOfAge = (*it)->checkAge();
+            if ((*it)->home && ZooAggregates::stateOf(**it).sick != before.sick) (*it)->home->happinessDirty = true;
+            aggregates.changeAnimal(**it, before);
+
+            if (diedOfAge) {
+                forgetAnimal(**it);
+                it = animals.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+// Обновление состояния вольеров: чистота и болезни внутри вольера
+
+    void updateEnclosures() {
+        for (auto& enclosure : enclosures) {
+            enclosure->updateCleanliness();
+            stateScratch.clear();
+            for (auto animal : enclosure->containedAnimals) stateScratch.push_back(ZooAggregates::stateOf(*animal));
+            enclosure->spreadDisease();
+            for (size_t i = 0; i < stateScratch.size(); i++) {
+                aggregates.changeAnimal(*enclosure->containedAnimals[i], stateScratch[i]);
+            }
+        }
+    }
+
+// Остаток дня после утренних проверок: персонал, корм, счастье, побеги, доход и окончание игры
+
+    void finishDay() {
+        runContagionSystem();
+
+        // Работа персонала
+        if (shiftTickMinutes > 0) {
+            runStaffShift();
+        }
+        else {
+            runCleaningSystem();
+            runVeterinarySystem();
+        }
+        runFeedingSystem();
+        runVisitorSystem();
+
+        runHappinessSystem();
+
+        // Проверка на побег животных (сбежать может только животное со счастьем до 15%).
+        // Сбежавшие убираются из animals одним проходом после проверки всех вольеров
+        vector<int> escapedIds;
+        for (size_t e = 0; aggregates.happinessHistogram[0] > 0 && e < enclosures.size(); e++) {
+            auto& enclosure = enclosures[e];
+            for (auto it = enclosure->containedAnimals.begin(); it != enclosure->containedAnimals.end(); ) {
+                ZooAggregates::AnimalState before = ZooAggregates::stateOf(**it);
+                if ((*it)->tryEscape()) {
+                    escapedIds.push_back((*it)->id);
+                    aggregates.changeAnimal(**it, before);
+                    aggregates.removeAnimal(**it);
+                    aggregates.placeAnimal(*enclosure, -1);
+                    animalsMap.erase((*it)->id);
+                    it = enclosure->containedAnimals.erase(it);
+                    enclosure->happinessDirty = true;
+                }
+                else {
+                    ++it;
+                }
+            }
+        }
+        if (!escapedIds.empty()) {
+            sort(escapedIds.begin(), escapedIds.end());
+            animals.erase(remove_if(animals.begin(), animals.end(), [&](const unique_ptr<Animal>& a) {
+                return binary_search(escapedIds.begin(), escapedIds.end(), a->id);
+            }), animals.end());
+        }
+
+        // Расчет посетителей и дохода
+        long long income = 0;
+        VisitorDayResult crowd;
+        if (visitorEngine) {
+            crowd = simulateVisitors();
+            visitors = crowd.visitors;
+            income = crowd.spending;
+        }
+        else {
+            visitors = min(2 * popularity, 1000);
+            income = 100LL * visitors * aggregates.aliveAnimals;
+        }
+        ledger.post(LEDGER_VISITORS, income);
+
+        // Изменение популярности
+        int popularityChange = visitorEngine ? crowd.popularityChange : simRand() % 3 - 1;
+        popularity = max(0, popularity + popularityChange);
+
+        simOut() << L"Популярность зоопарка: " << popularity << endl;
+        simOut() << L"Посетители сегодня: " << visitors << L" чел." << endl;
+        simOut() << L"Доход от посетителей: " << income << L" руб." << endl;
+
+        // Выплата зарплат
+        payWorkers();
+
+        // Запись показателей дня в историю и проведение денежных операций дня
+        recordHistory();
+        ledger.commit();
+
+        // Показать счастье животных
+        if (!simOutQuiet()) showAnimalHappiness();
+
+        // Проверка условий окончания игры
+        if (totalFood() == 0 && aggregates.aliveAnimals > 0) {
+            simOut() << L"Все животные умерли от голода! Игра окончена." << endl;
+            gameOver = true;
+            return;
+        }
+
+        if (ledger.balance() < 0) {
+            simOut() << L"Вы банкрот! Игра окончена." << endl;
+            gameOver = true;
+            return;
+        }
+
+        if (days >= victoryDays) {
+            simOut() << L"Поздравляем! Вы успешно управляли зоопарком " << victoryDays << L" дней!" << endl;
+            gameOver = true;
+            return;
+        }
+
+        // Периодическое обновление рынка
+        if (days % 3 == 0) {
+            refreshMarket();
+        }
+    }
+
+public:
+    wstring name;
+    ZooLedger ledger;
+    array<int, FOOD_TYPE_COUNT> foodStock;
+    int popularity;
+    vector<unique_ptr<Animal>> animals;
+    vector<unique_ptr<Enclosure>> enclosures;
+    vector<unique_ptr<Worker>> workers;
+    int visitors;
+    int days;
+    int victoryDays;
+    int nextAnimalId;
+    int nextEnclosureId;
+    int nextWorkerId;
+    wstring directorName;
+    StaffTotals staff;
+    ZooAggregates aggregates;
+    KpiHistory history;
+
+#ifndef ZOOSIMS_CORE
+// Конструктор зоопарка для консольной игры: имя директора запрашивается с клавиатуры
+
+    Zoo(wstring zooName, int victoryDaysCount)
+        : name(move(zooName)), ledger(500000), foodStock{ { 50, 50, 50 } }, popularity(10), visitors(20),
+        days(0), victoryDays(victoryDaysCount), nextAnimalId(1), nextEnclosureId(1),
+        nextWorkerId(1), testMode(false),
+        marketRefreshCost(5000), animalsBoughtToday(0), gameOver(false), journal(nullptr),
+        visitorEngine(nullptr), layout(make_shared<ZooMap>()), hibernated(nullptr),
+        history(KPI_SPECIES_FIRST + SpeciesCatalog::instance().size()) {
+        (void)_setmode(_fileno(stdout), _O_U16TEXT);
+        (void)_setmode(_fileno(stdin), _O_U16TEXT);
+        setlocale(LC_ALL, "ru_RU.UTF-8");
+
+        directorName = safeInputString(L"Введите имя директора зоопарка: ");
+        refreshMarket();
+    }
+
+// Покупка животного с рынка
+
+    void buyAnimal() {
+        if (!canBuyAnimalToday()) {
+            simOut() << L"После 10 дня можно покупать только 1 животное в день!" << endl;
+            return;
+        }
+        showMarketAnimals();
+        if (marketAnimals.empty()) return;
+
+        int choice = safeInputInt(L"Выберите животное для покупки (1-" + to_wstring(marketAnimals.size()) + L" или 0 для отмены): ");
+        purchaseAnimal(choice);
+    }
+
+    void sellAnimal() {
+        ensureEntities();
+        if (animals.empty()) {
+            simOut() << L"Нет животных для продажи!" << endl;
+            return;
+        }
+        simOut() << L"\n=== Продажа животного ===" << endl;
+        simOut() << L"Список животных:" << endl;
+        for (const auto& animal : animals) {
+            if (animal->getIsAlive()) {
+                simOut() << L"ID:" << animal->id << L" | " << animal->name << L" | Цена: " << static_cast<int>(animal->price * 0.7) << L" руб." << endl;
+            }
+        }
+
+        int id = safeInputInt(L"Введите ID животного для продажи (0 для отмены): ");
+        if (id == 0) return;
+        sellAnimalById(id);
+    }
+
+    void renameAnimal() {
+        ensureEntities();
+        if (animals.empty()) {
+            simOut() << L"Нет животных для переименования!" << endl;
+            return;
+        }
+        showAnimals();
+        int id = safeInputInt(L"Введите ID животного для переименования (0 для отмены): ");
+        if (id == 0) return;
+
+        if (!findAnimal(id)) {
+            simOut() << L"Животное с таким ID не найдено!" << endl;
+            return;
+        }
+
+        simOut() << L"Введите новое имя для животного: ";
+        wstring newName;
+        getline(wcin, newName);
+        renameAnimalById(id, newName);
+    }
+
+    void tryBreedAnimals() {
+        ensureEntities();
+        if (animals.size() < 2) {
+            simOut() << L"Нужно как минимум 2 животных для размножения!" << endl;
+            return;
+        }
+        showAnimals();
+        int id1 = safeInputInt(L"Введите ID первого животного: ");
+        int id2 = safeInputInt(L"Введите ID второго животного: ");
+        breedAnimals(id1, id2);
+    }
+
+    void buyEnclosure() {
+        ensureEntities();
+        simOut() << L"\n=== Покупка вольера ===" << endl;
+        simOut() << L"Типы вольеров:" << endl;
+        const SpeciesCatalog& catalog = SpeciesCatalog::instance();
+        for (const auto& info : catalog.enclosureTypes()) {
+            simOut() << info.choice << L". " << info.name << L" (" << info.capacity << L" животных, " << info.price << L" руб.)" << endl;
+        }
+
+        int typeChoice = safeInputInt(L"Выберите тип вольера (0 для отмены): ");
+        if (!catalog.enclosureByChoice(typeChoice)) return;
+
+        vector<wstring> neededClimates;
+        for (size_t i = 0; i < climates.size(); i++) {
+            if (aggregates.climatePopulation[i] > 0) neededClimates.push_back(climates[i]);
+        }
+
+        if (neededClimates.empty()) {
+            for (size_t i = 0; i < climates.size(); i++) {
+                simOut() << (i + 1) << L". " << climates[i] << endl;
+            }
+        }
+        else {
+            for (size_t i = 0; i < neededClimates.size(); i++) {
+                simOut() << (i + 1) << L". " << neededClimates[i] << endl;
+            }
+        }
+        int climateChoice = safeInputInt(L"Выберите климат (1-" + to_wstring(neededClimates.empty() ? climates.size() : neededClimates.size()) + L"): ");
+        if (climateChoice < 1 || climateChoice > static_cast<int>(neededClimates.empty() ? climates.size() : neededClimates.size())) return;
+
+        wstring selectedClimate = neededClimates.empty() ? climates[climateChoice - 1] : neededClimates[climateChoice - 1];
+        purchaseEnclosure(typeChoice, selectedClimate);
+    }
+
+    void cleanEnclosure() {
+        showEnclosures();
+        int id = safeInputInt(L"Введите ID вольера для уборки (0 для отмены): ");
+        if (id != 0) cleanEnclosureById(id);
+    }
+
+    void hireWorker() {
+        simOut() << L"\n=== Наем работника ===" << endl;
+        simOut() << L"Типы работников:" << endl;
+        const SpeciesCatalog& catalog = SpeciesCatalog::instance();
+        for (int type = WORKER_VET; type <= WORKER_GUIDE; type++) {
+            const WorkerTypeInfo& info = catalog.worker(static_cast<WorkerType>(type));
+            simOut() << type + 1 << L". " << info.name << L" (" << info.salary << L" руб./день)" << endl;
+        }
+
+        int typeChoice = safeInputInt(L"Выберите тип работника (1-5 или 0 для отмены): ");
+        if (typeChoice < 1 || typeChoice > 5) return;
+
+        WorkerType type = static_cast<WorkerType>(typeChoice - 1);
+        if (!ledger.canAfford(catalog.worker(type).salary)) {
+            simOut() << L"Недостаточно денег для найма!" << endl;
+            return;
+        }
+
+        wstring workerName = safeInputString(L"Введите имя работника: ");
+        hireWorkerOfType(type, workerName);
+    }
+
+    void buyFood() {
+        ensureEntities();
+        simOut() << L"\n=== Покупка корма ===" << endl;
+        array<int, FOOD_TYPE_COUNT> need = dailyFoodNeed();
+        for (int type = 0; type < FOOD_TYPE_COUNT; type++) {
+            simOut() << type + 1 << L". " << foodTypeNames[type] << L" (запас " << foodStock[type]
+                << L" ед., нужно в день " << need[type] << L" ед.)" << endl;
+        }
+        int type = safeInputInt(L"Выберите тип корма (1-3 или 0 для отмены): ");
+        if (type < 1 || type > FOOD_TYPE_COUNT) return;
+
+        simOut() << L"1. Маленькая упаковка (50 ед., 5,000 руб.)" << endl;
+        simOut() << L"2. Средняя упаковка (100 ед., 9,000 руб.)" << endl;
+        simOut() << L"3. Большая упаковка (200 ед., 16,000 руб.)" << endl;
+
+        int choice = safeInputInt(L"Выберите вариант (1-3 или 0 для отмены): ");
+        purchaseFood(choice, static_cast<FoodType>(type - 1));
+    }
+
+    void advertise() {
+        simOut() << L"\n=== Реклама зоопарка ===" << endl;
+        simOut() << L"1. Бюджетная реклама (+1 популярность, 5,000 руб.)" << endl;
+        simOut() << L"2. Стандартная реклама (+3 популярность, 15,000 руб.)" << endl;
+        simOut() << L"3. Широкая рекламная кампания (+7 популярность, 30,000 руб.)" << endl;
+
+        int choice = safeInputInt(L"Выберите вариант (1-3 или 0 для отмены): ");
+        orderAdvertising(choice);
+    }
+
+// Перемотка до заданного дня с итогом: сколько дней прошло и почему перемотка остановилась
+
+    void fastForwardDays() {
+        int target = safeInputInt(L"До какого дня перемотать (сейчас день " + to_wstring(days) + L"): ");
+        FastForwardResult result = fastForward(target);
+        simOut() << L"Перемотано дней: " << result.days << L" (тихих: " << result.quietDays << L"), сейчас день "
+            << days << L". Остановка: " << fastForwardStopNames[static_cast<int>(result.stop)] << L"." << endl;
+    }
+
+// Дефрагментация животных по запросу игрока с отчетом о раздробленности
+
+    void showDefragmentation() {
+        DefragmentReport report = defragmentAnimals();
+        simOut() << L"Животных перенесено: " << report.animals << L". Раздробленность вольеров: "
+            << lround(report.fragmentationBefore * 100) << L"% -> " << lround(report.fragmentationAfter * 100) << L"%" << endl;
+    }
+#endif
+
+private:
+// Конструктор ветки симуляции (см. fork)
+
+    Zoo(const Zoo& source, shared_ptr<ZooEntities> entities)
+        : testMode(source.testMode), marketRefreshCost(source.marketRefreshCost), lastMarketRefresh(source.lastMarketRefresh),
+        animalsBoughtToday(source.animalsBoughtToday), gameOver(source.gameOver),
+        shiftTickMinutes(source.shiftTickMinutes), isBranch(true), sharedEntities(move(entities)), journal(nullptr),
+        visitorEngine(source.visitorEngine), layout(source.layout), contactGraph(source.contactGraph),
+        keeperContacts(source.keeperContacts), hibernated(nullptr),
+        name(source.name), ledger(source.ledger), foodStock(source.foodStock), popularity(source.popularity),
+        visitors(source.visitors), days(source.days), victoryDays(source.victoryDays),
+        nextAnimalId(source.nextAnimalId), nextEnclosureId(source.nextEnclosureId), nextWorkerId(source.nextWorkerId),
+        directorName(source.directorName), staff(source.staff), aggregates(source.aggregates),
+        history(KPI_SPECIES_FIRST + SpeciesCatalog::instance().size()) {
+    }
+
+public:
+// Конструктор зоопарка без консольного ввода (для хоста и автоматизации)
+
+    Zoo(wstring zooName, wstring director, int victoryDaysCount)
+        : testMode(false), marketRefreshCost(5000), animalsBoughtToday(0), gameOver(false),
+        journal(nullptr), visitorEngine(nullptr), layout(make_shared<ZooMap>()), hibernated(nullptr),
+        name(move(zooName)), ledger(500000), foodStock{ { 50, 50, 50 } }, popularity(10), visitors(20),
+        days(0), victoryDays(victoryDaysCount), nextAnimalId(1), nextEnclosureId(1),
+        nextWorkerId(1), directorName(move(director)),
+        history(KPI_SPECIES_FIRST + SpeciesCatalog::instance().size()) {
+        refreshMarket();
+    }
+
+// Массовая загрузка готовой партии сущностей (генератор сценариев): без сообщений и
+// пошаговых проверок. Сущности получают новые ID, вся партия проверяется одним проходом
+// и только затем переносится в зоопарк, после чего карты, сводка и план участков
+// пересобираются один раз. При несогласованной партии бросается invalid_argument
+// и зоопарк не изменяется
+
+    void bulkInsert(EntityBatch batch) {
+        ensureEntities();
+        int firstAnimalId = nextAnimalId;
+        for (size_t i = 0; i < batch.animals.size(); i++) batch.animals[i]->id = firstAnimalId + static_cast<int>(i);
+        vector<uint8_t> placed(batch.animals.size(), 0);
+        size_t homed = 0;
+        for (const auto& animal : batch.animals) homed += animal->home != nullptr;
+        size_t contained = 0;
+        for (const auto& enclosure : batch.enclosures) {
+            if (enclosure->containedAnimals.size() > static_cast<size_t>(enclosure->capacity)) {
+                throw invalid_argument("bulk insert: enclosure over capacity");
+            }
+            for (Animal* animal : enclosure->containedAnimals) {
+                size_t index = static_cast<size_t>(animal->id - firstAnimalId);
+                if (animal->home != enclosure.get() || index >= placed.size() || placed[index]++ != 0 ||
+                    batch.animals[index].get() != animal) {
+                    throw invalid_argument("bulk insert: animal placement mismatch");
+                }
+                if (animal->climate != enclosure->climate || !enclosure->isSuitableForAnimalType(animal->getType())) {
+                    throw invalid_argument("bulk insert: unsuitable enclosure");
+                }
+            }
+            contained += enclosure->containedAnimals.size();
+        }
+        if (contained != homed) throw invalid_argument("bulk insert: animal outside batch enclosures");
+
+        nextAnimalId += static_cast<int>(batch.animals.size());
+        for (auto& enclosure : batch.enclosures) enclosure->id = nextEnclosureId++;
+        for (auto& worker : batch.workers) worker->id = nextWorkerId++;
+        animals.reserve(animals.size() + batch.animals.size());
+        enclosures.reserve(enclosures.size() + batch.enclosures.size());
+        workers.reserve(workers.size() + batch.workers.size());
+        move(batch.animals.begin(), batch.animals.end(), back_inserter(animals));
+        move(batch.enclosures.begin(), batch.enclosures.end(), back_inserter(enclosures));
+        move(batch.workers.begin(), batch.workers.end(), back_inserter(workers));
+        animalsMap.reserve(animals.size());
+        enclosuresMap.reserve(enclosures.size());
+        workersMap.reserve(workers.size());
+        updateMaps();
+    }
+
+// Ветвление симуляции: новая ветка получает копию скалярного состояния,
+// а животные, вольеры и работники становятся общим снимком (копирование при записи).
+// Ветка не наследует историю показателей. Удаление нетронутой ветки стоит O(1)
+
+    unique_ptr<Zoo> fork() {
+        if (hibernated) wake();
+        if (!sharedEntities) {
+            sharedEntities = make_shared<ZooEntities>();
+            sharedEntities->animals = move(animals);
+            sharedEntities->enclosures = move(enclosures);
+            sharedEntities->workers = move(workers);
+            sharedEntities->marketAnimals = move(marketAnimals);
+            sharedEntities->animalsMap = move(animalsMap);
+            sharedEntities->enclosuresMap = move(enclosuresMap);
+            sharedEntities->workersMap = move(workersMap);
+            animals.clear();
+            enclosures.clear();
+            workers.clear();
+            marketAnimals.clear();
+            animalsMap.clear();
+            enclosuresMap.clear();
+            workersMap.clear();
+        }
+        return unique_ptr<Zoo>(new Zoo(*this, sharedEntities));
+    }
+
+// Получение собственных сущностей перед их изменением: если снимок больше
+// ни с кем не разделен, он забирается обратно без копирования, иначе копируется.
+// Вызывается всеми изменяющими методами зоопарка; для чтения снаружи есть animalList,
+// enclosureList и workerList, которые ничего не копируют
+
+    void ensureEntities() {
+        if (hibernated) wake();
+        if (!sharedEntities) return;
+        shared_ptr<ZooEntities> source = move(sharedEntities);
+        sharedEntities.reset();
+        if (source.use_count() == 1) {
+            // use_count читается без упорядочивания: барьер делает видимыми все записи
+            // веток, которые отпустили снимок в других потоках
+            atomic_thread_fence(memory_order_acquire);
+            animals = move(source->animals);
+            enclosures = move(source->enclosures);
+            workers = move(source->workers);
+            marketAnimals = move(source->marketAnimals);
+            animalsMap = move(source->animalsMap);
+            enclosuresMap = move(source->enclosuresMap);
+            workersMap = move(source->workersMap);
+            return;
+        }
+
+        animals.reserve(source->animals.size());
+        for (const auto& animal : source->animals) animals.push_back(make_unique<Animal>(*animal));
+        marketAnimals.reserve(source->marketAnimals.size());
+        for (const auto& animal : source->marketAnimals) marketAnimals.push_back(make_unique<Animal>(*animal));
+        workers.reserve(source->workers.size());
+        for (const auto& worker : source->workers) workers.push_back(make_unique<Worker>(*worker));
+        enclosures.reserve(source->enclosures.size());
+        for (const auto& enclosure : source->enclosures) enclosures.push_back(make_unique<Enclosure>(*enclosure));
+        updateMaps();
+        for (auto& enclosure : enclosures) {
+            for (auto& animal : enclosure->containedAnimals) {
+                animal = animalsMap.at(animal->id);
+                animal->home = enclosure.get();
+            }
+        }
+    }
+
+// Сущности зоопарка только для чтения: пока ветка ничего не меняла, они читаются
+// прямо из общего снимка. Чтение ничего не копирует и не меняет, поэтому оценка,
+// отрисовка и публикация состояния принимают const Zoo&. Спящий зоопарк при чтении
+// не просыпается: его сначала будят вызовом wake()
+
+    const vector<unique_ptr<Animal>>& animalList() const {
+        return sharedEntities ? sharedEntities->animals : animals;
+    }
+
+    const vector<unique_ptr<Enclosure>>& enclosureList() const {
+        return sharedEntities ? sharedEntities->enclosures : enclosures;
+    }
+
+    const vector<unique_ptr<Worker>>& workerList() const {
+        return sharedEntities ? sharedEntities->workers : workers;
+    }
+
+    bool isForkShared() const { return sharedEntities != nullptr; }
+
+// Перевод простаивающего зоопарка в компактный вид: животные упаковываются в записи
+// по 32 байта, объекты Animal освобождаются. Зоопарк просыпается при первом изменении
+
+    void hibernate() {
+        ensureEntities();
+        auto state = make_unique<HibernatedAnimals>();
+        unordered_map<const Animal*, uint32_t> recordIndex;
+        recordIndex.reserve(animals.size());
+        state->animals.reserve(animals.size());
+        for (const auto& animal : animals) {
+            recordIndex[animal.get()] = static_cast<uint32_t>(state->animals.size());
+            state->animals.append(*animal);
+        }
+        state->market.reserve(marketAnimals.size());
+        for (const auto& animal : marketAnimals) state->market.append(*animal);
+        state->enclosureMembers.resize(enclosures.size());
+        for (size_t i = 0; i < enclosures.size(); i++) {
+            for (auto animal : enclosures[i]->containedAnimals) state->enclosureMembers[i].push_back(recordIndex.at(animal));
+            enclosures[i]->containedAnimals.clear();
+        }
+
+        animals.clear();
+        marketAnimals.clear();
+        animalsMap.clear();
+        hibernated = move(state);
+        trimMemory();
+    }
+
+    bool isHibernating() const { return hibernated != nullptr; }
+
+    void wake() {
+        if (!hibernated) return;
+        unique_ptr<HibernatedAnimals> state = move(hibernated);
+        animals.reserve(state->animals.size());
+        for (size_t i = 0; i < state->animals.size(); i++) animals.push_back(state->animals.materialize(i));
+        marketAnimals.reserve(state->market.size());
+        for (size_t i = 0; i < state->market.size(); i++) marketAnimals.push_back(state->market.materialize(i));
+        for (size_t i = 0; i < enclosures.size() && i < state->enclosureMembers.size(); i++) {
+            for (uint32_t index : state->enclosureMembers[i]) enclosures[i]->attach(animals[index].get());
+        }
+        updateMaps();
+    }
+
+// Раздробленность хранения животных: доля соседних жильцов вольеров (в порядке containedAnimals),
+// которые лежат не в соседних ячейках AnimalSlab. 0 - каждый вольер занимает непрерывный отрезок
+
+    double animalFragmentation() {
+        ensureEntities();
+        size_t pairs = 0;
+        size_t breaks = 0;
+        uintptr_t slot = AnimalSlab::local().slotSize();
+        for (const auto& enclosure : enclosures) {
+            const vector<Animal*>& members = enclosure->containedAnimals;
+            for (size_t i = 1; i < members.size(); i++) {
+                pairs++;
+                if (reinterpret_cast<uintptr_t>(members[i]) != reinterpret_cast<uintptr_t>(members[i - 1]) + slot) breaks++;
+            }
+        }
+        return pairs > 0 ? static_cast<double>(breaks) / pairs : 0.0;
+    }
+
+// Дефрагментация животных: все животные переносятся в один новый непрерывный блок AnimalSlab
+// в порядке вольеров (жильцы каждого вольера подряд, затем животные вне вольеров), и в том же
+// порядке переставляется список животных. Указатели вольеров и карта ID переводятся на новые
+// объекты, старые ячейки освобождаются. Вызывается между днями
+
+    DefragmentReport defragmentAnimals() {
+        ensureEntities();
+        DefragmentReport report;
+        report.fragmentationBefore = animalFragmentation();
+        report.fragmentationAfter = report.fragmentationBefore;
+
+        vector<Animal*> order;
+        order.reserve(animals.size());
+        for (const auto& enclosure : enclosures) {
+            order.insert(order.end(), enclosure->containedAnimals.begin(), enclosure->containedAnimals.end());
+        }
+        for (const auto& animal : animals) {
+            if (!animal->home) order.push_back(animal.get());
+        }
+        if (order.empty() || order.size() != animals.size()) return report;
+
+        AnimalSlab& slab = AnimalSlab::local();
+        char* run = static_cast<char*>(slab.allocateRun(order.size()));
+        vector<unique_ptr<Animal>> compacted;
+        compacted.reserve(order.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            compacted.emplace_back(new (run + i * slab.slotSize()) Animal(move(*order[i])));
+        }
+        size_t next = 0;
+        for (auto& enclosure : enclosures) {
+            for (auto& animal : enclosure->containedAnimals) animal = compacted[next++].get();
+        }
+        for (const auto& animal : compacted) animalsMap[animal->id] = animal.get();
+        animals = move(compacted);
+
+        report.animals = animals.size();
+        report.fragmentationAfter = animalFragmentation();
+        return report;
+    }
+
+// Закончена ли игра (победа, банкротство или голод)
+
+    bool isGameOver() const { return gameOver; }
+
+// Поиск животного по ID
+
+    Animal* findAnimal(int id) {
+        ensureEntities();
+        auto it = animalsMap.find(id);
+        return it != animalsMap.end() ? it->second : nullptr;
+    }
+
+// Поиск вольера по ID
+
+    Enclosure* findEnclosure(int id) {
+        ensureEntities();
+        auto it = enclosuresMap.find(id);
+        return it != enclosuresMap.end() ? it->second : nullptr;
+    }
+
+// Поиск работника по ID
+
+    Worker* findWorker(int id) {
+        ensureEntities();
+        auto it = workersMap.find(id);
+        return it != workersMap.end() ? it->second : nullptr;
+    }
+
+// Обновление рынка животных
+
+    void refreshMarket() {
+        ensureEntities();
+        marketAnimals.clear();
+        const SpeciesCatalog& catalog = SpeciesCatalog::instance();
+        int count = min(5 + simRand() % 6, 10);
+
+        for (int i = 0; i < count; i++) {
+            const SpeciesInfo& info = catalog.at(simRand() % static_cast<int>(catalog.size()));
+            const wstring& species = info.name;
+            vector<int> possibleClimates;
+            for (int climate = 0; climate < static_cast<int>(climates.size()); climate++) {
+                if (info.livesIn(climate)) possibleClimates.push_back(climate);
+            }
+            wstring climate = climates[possibleClimates[simRand() % possibleClimates.size()]];
+
+            bool isPredator = info.isPredator;
+
+            wchar_t gender = (simRand() % 2) ? 'M' : 'F';
+            int age = simRand() % 5;
+            int weight = 1 + simRand() % 200;
+            int price = 5000 + simRand() % 45000;
+
+            marketAnimals.push_back(make_unique<Animal>(
+                nextAnimalId++,
+                generateAnimalName(species, gender),
+                species,
+                age,
+                weight,
+                climate,
+                isPredator,
+                price,
+                gender
+            ));
+        }
+        lastMarketRefresh = time(0);
+        simOut() << L"Рынок животных обновлен! Доступно " << marketAnimals.size() << L" животных." << endl;
+    }
+
+// Отображение главного меню
+
+    void showMainMenu() {
+        ensureEntities();
+        simOut() << L"\n=== " << name << L" ===" << endl;
+        simOut() << L"Директор: " << directorName << endl;
+        simOut() << L"День: " << days << L" из " << victoryDays << endl;
+        simOut() << L"Баланс: " << ledger.balance() << L" руб." << endl;
+        array<int, FOOD_TYPE_COUNT> need = dailyFoodNeed();
+        simOut() << L"Корм (запас/в день): мясо " << foodStock[FOOD_MEAT] << L"/" << need[FOOD_MEAT]
+            << L", рыба " << foodStock[FOOD_FISH] << L"/" << need[FOOD_FISH]
+            << L", растительный " << foodStock[FOOD_PLANTS] << L"/" << need[FOOD_PLANTS] << endl;
+        simOut() << L"Популярность: " << popularity << endl;
+        simOut() << L"Посетители сегодня: " << visitors << L" чел." << endl;
+        simOut() << L"Животные: " << aggregates.aliveAnimals << L" шт. (больны: " << aggregates.sickAnimals
+            << L", мертвы: " << aggregates.deadAnimals << L", среднее счастье: " << aggregates.averageHappiness() << L"%)" << endl;
+        simOut() << L"Вольеры: " << enclosures.size() << L" шт." << endl;
+        simOut() << L"Работники: " << workers.size() << L" чел." << endl;
+
+        simOut() << L"\nГлавное меню:" << endl;
+        simOut() << L"1. Животные" << endl;
+        simOut() << L"2. Вольеры" << endl;
+        simOut() << L"3. Работники" << endl;
+        simOut() << L"4. Купить еду" << endl;
+        simOut() << L"5. Заказать рекламу" << endl;
+        simOut() << L"6. Следующий день" << endl;
+        simOut() << L"7. Показать счастье животных" << endl;
+        simOut() << L"8. История показателей" << endl;
+        simOut() << L"10. Совет управляющего" << endl;
+        simOut() << L"11. Автопилот" << endl;
+        simOut() << L"12. Живая панель" << endl;
+        simOut() << L"13. Режим реального времени" << endl;
+        simOut() << L"14. Модель посетителей: " << (visitorEngine ? L"включена" : L"выключена") << endl;
+        simOut() << L"15. Финансы" << endl;
+        simOut() << L"16. Смена персонала по тикам: " << (shiftTickMinutes > 0 ? L"включена" : L"выключена") << endl;
+        simOut() << L"17. Перемотка" << endl;
+        simOut() << L"18. Дефрагментация животных" << endl;
+        simOut() << L"9. Выход" << endl;
+    }
+
+// Отображение меню животных
+
+    void showAnimalsMenu() {
+        simOut() << L"\n=== Животные ===" << endl;
+        simOut() << L"1. Купить животное с рынка" << endl;
+        simOut() << L"2. Продать животное" << endl;
+        simOut() << L"3. Просмотреть животных" << endl;
+        simOut() << L"4. Обновить рынок животных (" << marketRefreshCost << L" руб.)" << endl;
+        simOut() << L"5. Переименовать животное" << endl;
+        simOut() << L"6. Попробовать размножить животных" << endl;
+        simOut() << L"0. Назад" << endl;
+    }
+
+// Отображение меню вольеров
+
+    void showEnclosuresMenu() {
+        simOut() << L"\n=== Вольеры ===" << endl;
+        simOut() << L"1. Купить вольер" << endl;
+        simOut() << L"2. Просмотреть вольеры" << endl;
+        simOut() << L"3. Убрать вольер" << endl;
+        simOut() << L"4. Карта зоопарка" << endl;
+        simOut() << L"0. Назад" << endl;
+    }
+
+// Отображение меню работников
+
+    void showWorkersMenu() {
+        simOut() << L"\n=== Работники ===" << endl;
+        simOut() << L"1. Нанять работника" << endl;
+        simOut() << L"2. Просмотреть работников" << endl;
+        simOut() << L"0. Назад" << endl;
+    }
+
+// Отображение животных на рынке
+
+    void showMarketAnimals() {
+        ensureEntities();
+        simOut() << L"\n=== Животные на рынке ===" << endl;
+        if (marketAnimals.empty()) {
+            simOut() << L"На рынке нет животных!" << endl;
+            return;
+        }
+        for (size_t i = 0; i < marketAnimals.size(); i++) {
+            const auto& animal = marketAnimals[i];
+            simOut() << (i + 1) << L". " << animal->name << L" (" << (animal->gender == 'M' ? L"Самец" : L"Самка") << L")"
+                << L" | Вид: " << animal->species << L" | Возраст: " << animal->age << L" дней"
+                << L" | Вес: " << animal->weight << L" кг" << L" | Климат: " << animal->climate
+                << L" | Тип: " << animalTypes[static_cast<int>(animal->getType())]
+                << L" | " << (animal->isPredator ? L"Хищник" : L"Травоядное")
+                << L" | Цена: " << animal->price << L" руб." << endl;
+        }
+    }
+
+// Можно ли сегодня купить еще одно животное
+
+    bool canBuyAnimalToday() const {
+        return !(days > 10 && animalsBoughtToday >= 1);
+    }
+
+    size_t marketSize() const {
+        return (sharedEntities ? sharedEntities->marketAnimals : marketAnimals).size();
+    }
+
+    const Animal* marketAnimal(size_t index) const {
+        const vector<unique_ptr<Animal>>& market = sharedEntities ? sharedEntities->marketAnimals : marketAnimals;
+        return index < market.size() ? market[index].get() : nullptr;
+    }
+
+// Первый вольер со свободным местом, подходящий животному по климату и типу
+
+    Enclosure* findFreeEnclosure(const Animal& animal) {
+        for (auto& enclosure : enclosures) {
+            if (enclosure->containedAnimals.size() >= static_cast<size_t>(enclosure->capacity)) continue;
+            if (enclosure->climate != animal.climate) continue;
+            if (!enclosure->isSuitableForAnimalType(animal.getType())) continue;
+            return enclosure.get();
+        }
+        return nullptr;
+    }
+
+// Покупка животного с рынка по номеру позиции (1..marketSize())
+
+    bool purchaseAnimal(int choice) {
+        ensureEntities();
+        if (!canBuyAnimalToday()) {
+            simOut() << L"После 10 дня можно покупать только 1 животное в день!" << endl;
+            return false;
+        }
+        if (choice < 1 || choice > static_cast<int>(marketAnimals.size())) return false;
+
+        auto& animalToBuy = marketAnimals[choice - 1];
+        if (!ledger.canAfford(animalToBuy->price)) {
+            simOut() << L"Недостаточно денег для покупки!" << endl;
+            return false;
+        }
+
+        bool foundEnclosure = false;
+        if (Enclosure* enclosure = findFreeEnclosure(*animalToBuy)) {
+            auto newAnimal = make_unique<Animal>(*animalToBuy);
+            newAnimal->id = nextAnimalId++;
+            animals.push_back(move(newAnimal));
+            registerAnimal(animals.back().get());
+            placeAnimal(*enclosure, animals.back().get());
+            foundEnclosure = true;
+            animalsBoughtToday++;
+            ledger.post(LEDGER_ANIMAL_PURCHASES, -animalToBuy->price);
+            simOut() << L"Вы купили " << animalToBuy->name << L" за " << animalToBuy->price << L" руб." << endl;
+        }
+
+        if (!foundEnclosure) {
+            bool hasAquarium = false;
+            bool hasMatchingClimate = false;
+            bool hasCapacity = false;
+
+            for (auto& enclosure : enclosures) {
+                if (enclosure->type == ENCLOSURE_AQUARIUM) {
+                    hasAquarium = true;
+                    if (enclosure->climate == animalToBuy->climate) {
+                        hasMatchingClimate = true;
+                    }
+                    if (enclosure->containedAnimals.size() < static_cast<size_t>(enclosure->capacity)) {
+                        hasCapacity = true;
+                    }
+                }
+            }
+
+            if (!hasAquarium && animalToBuy->getType() == AnimalType::AQUATIC) {
+                simOut() << L"Нет вольера типа 'Аквариум' для водного животного!" << endl;
+            }
+            else if (!hasMatchingClimate) {
+                simOut() << L"Нет вольера с подходящим климатом (" << animalToBuy->climate << L")!" << endl;
+            }
+            else if (!hasCapacity) {
+                simOut() << L"Все подходящие вольеры переполнены!" << endl;
+            }
+            else {
+                simOut() << L"Нет подходящего вольера для этого животного!" << endl;
+            }
+            return false;
+        }
+        return true;
+    }
+
+// Продажа животного по ID за 70% цены
+
+    bool sellAnimalById(int id) {
+        unique_ptr<Animal> animal = releaseAnimal(id);
+        if (!animal) {
+            simOut() << L"Животное с таким ID не найдено или уже мертво!" << endl;
+            return false;
+        }
+
+        int sellPrice = static_cast<int>(animal->price * 0.7);
+        ledger.post(LEDGER_ANIMAL_SALES, sellPrice);
+        simOut() << L"Вы продали животное за " << sellPrice << L" руб." << endl;
+        return true;
+    }
+
+// Передача живого животного из зоопарка (продажа, заявка на бирже). nullptr, если его нет
+
+    unique_ptr<Animal> releaseAnimal(int id) {
+        ensureEntities();
+        auto it = find_if(animals.begin(), animals.end(), [id](const unique_ptr<Animal>& a) { return a->id == id && a->getIsAlive(); });
+        if (it == animals.end()) return nullptr;
+
+        forgetAnimal(**it);
+        unique_ptr<Animal> animal = move(*it);
+        animals.erase(it);
+        return animal;
+    }
+
+// Резерв денег под заявку на покупку
+
+    bool reserveMoney(int amount) {
+        if (!ledger.canAfford(amount)) return false;
+        ledger.post(LEDGER_EXCHANGE, -amount);
+        return true;
+    }
+
+// Итог заявки на бирже: деньги и/или животное. Животное получает новый ID и
+// помещается в подходящий вольер, а если его нет - содержится вне вольеров
+
+    void receiveExchange(int amount, unique_ptr<Animal> animal) {
+        ensureEntities();
+        ledger.post(LEDGER_EXCHANGE, amount);
+        if (!animal) return;
+        animal->id = nextAnimalId++;
+        animals.push_back(move(animal));
+        Animal* arrived = animals.back().get();
+        registerAnimal(arrived);
+        simOut() << arrived->name << L" (" << arrived->species << L") прибыл с биржи." << endl;
+        if (Enclosure* enclosure = findFreeEnclosure(*arrived)) placeAnimal(*enclosure, arrived);
+        else simOut() << L"Нет подходящего вольера, животное содержится вне вольеров." << endl;
+    }
+
+    void showAnimals() {
+        ensureEntities();
+        simOut() << L"\n=== Список животных ===" << endl;
+        if (animals.empty()) {
+            simOut() << L"Животных нет" << endl;
+            return;
+        }
+        for (const auto& animal : animals) {
+            wstring parentsInfo;
+            if (animal->getParentId1() != -1 && animal->getParentId2() != -1) {
+                parentsInfo = L" | Родители: " + to_wstring(animal->getParentId1()) + L" и " + to_wstring(animal->getParentId2());
+            }
+            simOut() << L"ID:" << animal->id << L" | " << animal->name
+                << L" (" << (animal->gender == 'M' ? L"Самец" : L"Самка") << L")"
+                << L" | Вид: " << animal->species << L" | Возраст: " << animal->age << L" дней"
+                << L" | Вес: " << animal->weight << L" кг" << L" | Климат: " << animal->climate
+                << L" | Тип: " << animalTypes[static_cast<int>(animal->getType())]
+                << L" | " << (animal->isPredator ? L"Хищник" : L"Травоядное")
+                << L" | Здоровье: " << healthStatus[static_cast<int>(animal->getHealth())]
+                << L" | Цена: " << animal->price << L" руб." << parentsInfo
+                << L" | Гены: " << Genome::describe(animal->genome) << endl;
+        }
+    }
+
+    bool renameAnimalById(int id, const wstring& newName) {
+        auto animal = findAnimal(id);
+        if (!animal) {
+            simOut() << L"Животное с таким ID не найдено!" << endl;
+            return false;
+        }
+        animal->rename(newName);
+        return true;
+    }
+
+// Размножение двух животных по их ID
+
+    bool breedAnimals(int id1, int id2) {
+        ensureEntities();
         auto animal1 = findAnimal(id1);
         auto animal2 = findAnimal(id2);
         if (!animal1 || !animal2 || !animal1->getIsAlive() || !animal2->getIsAlive()) {
-            wcout << L"Одно или оба животных не найдены или мертвы!" << endl;
+            simOut() << L"Одно или оба животных не найдены или мертвы!" << endl;
+            return false;
+        }
+
+        Enclosure* parentsEnclosure = nullptr;
+        for (auto& enclosure : enclosures) {
+            bool found1 = false, found2 = false;
+            for (auto animal : enclosure->containedAnimals) {
+                if (animal->id == id1) found1 = true;
+                if (animal->id == id2) found2 = true;
+            }
+            if (found1 && found2) {
+                parentsEnclosure = enclosure.get();
+                break;
+            }
+        }
+
+        if (!parentsEnclosure) {
+            simOut() << L"Животные должны быть в одном вольере для размножения!" << endl;
+            return false;
+        }
+
+        if (parentsEnclosure->containedAnimals.size() >= static_cast<size_t>(parentsEnclosure->capacity)) {
+            simOut() << L"В вольере нет места для потомства!" << endl;
+            return false;
+        }
+
+        auto offspring = *animal1 + *animal2;
+        if (offspring.empty()) {
+            simOut() << L"Размножение не удалось!" << endl;
+            return false;
+        }
+
+        for (auto& baby : offspring) {
+            baby->id = nextAnimalId++;
+            animals.push_back(move(baby));
+            registerAnimal(animals.back().get());
+            if (!placeAnimal(*parentsEnclosure, animals.back().get())) {
+                simOut() << L"Не удалось добавить потомка в вольер!" << endl;
+            }
+        }
+        return true;
+    }
+
+// Массовое размножение пар (ID в любом порядке). Пара размножается, если оба животных
+// могут размножаться, разнополы и живут в одном вольере; помет урезается до свободных мест
+// вольера. Геномы всех детенышей считаются одним вызовом Genome::inherit.
+// Возвращает число родившихся детенышей
+
+    int breedPairs(const vector<pair<int, int>>& pairs) {
+        ensureEntities();
+        struct Litter {
+            Animal* first;
+            Animal* father;
+            Animal* mother;
+            int count;
+        };
+        vector<Litter> litters;
+        vector<uint16_t> fathers;
+        vector<uint16_t> mothers;
+        unordered_map<const Enclosure*, int> born;
+        for (const auto& parents : pairs) {
+            Animal* first = findAnimal(parents.first);
+            Animal* second = findAnimal(parents.second);
+            if (!first || !second || first->gender == second->gender || !first->canReproduce() || !second->canReproduce()) continue;
+            Enclosure* home = first->home;
+            if (!home || home != second->home) continue;
+            int& placed = born[home];
+            int room = home->capacity - static_cast<int>(home->containedAnimals.size()) - placed;
+            if (room <= 0) continue;
+            Animal* father = first->gender == 'M' ? first : second;
+            Animal* mother = first->gender == 'M' ? second : first;
+            int count = min(first->litterSize(), room);
+            placed += count;
+            litters.push_back({ first, father, mother, count });
+            fathers.insert(fathers.end(), count, father->genome);
+            mothers.insert(mothers.end(), count, mother->genome);
+        }
+
+        vector<uint16_t> genomes(fathers.size());
+        Genome::inherit(fathers.data(), mothers.data(), genomes.data(), genomes.size(), static_cast<uint32_t>(simRand()));
+        animals.reserve(animals.size() + genomes.size());
+        size_t next = 0;
+        for (const Litter& litter : litters) {
+            for (int i = 0; i < litter.count; i++) {
+                auto baby = litter.first->makeBaby(*litter.father, *litter.mother, genomes[next++]);
+                baby->id = nextAnimalId++;
+                animals.push_back(move(baby));
+                registerAnimal(animals.back().get());
+                placeAnimal(*litter.father->home, animals.back().get());
+            }
+        }
+        simOut() << L"Размножились пар: " << litters.size() << L", родилось детенышей: " << genomes.size() << endl;
+        return static_cast<int>(genomes.size());
+    }
+
+// Покупка вольера по номеру типа в меню каталога с заданным климатом
+
+    bool purchaseEnclosure(int typeChoice, const wstring& selectedClimate) {
+        ensureEntities();
+        const EnclosureTypeInfo* info = SpeciesCatalog::instance().enclosureByChoice(typeChoice);
+        if (!info) return false;
+        if (find(climates.begin(), climates.end(), selectedClimate) == climates.end()) return false;
+
+        EnclosureType type = info->type;
+        int capacity = info->capacity;
+        int price = info->price;
+
+        if (!ledger.canAfford(price)) {
+            simOut() << L"Недостаточно денег для покупки!" << endl;
+            return false;
+        }
+
+        int newId = nextEnclosureId++;
+        enclosures.push_back(make_unique<Enclosure>(newId, capacity, type, selectedClimate, price / 10));
+        enclosuresMap[newId] = enclosures.back().get();
+        aggregates.addEnclosure(*enclosures.back());
+        syncLayout();
+        ledger.post(LEDGER_ENCLOSURES, -price);
+        simOut() << L"Вы купили новый вольер (ID:" << newId << L") за " << price << L" руб." << endl;
+        return true;
+    }
+
+// Уборка вольера силами дирекции (стоит столько же, сколько дневное содержание вольера)
+
+    bool cleanEnclosureById(int id) {
+        Enclosure* enclosure = findEnclosure(id);
+        if (!enclosure) {
+            simOut() << L"Вольер с таким ID не найден!" << endl;
+            return false;
+        }
+        if (enclosure->isClean) {
+            simOut() << L"Вольер уже чистый." << endl;
+            return false;
+        }
+        if (!ledger.canAfford(enclosure->maintenanceCost)) {
+            simOut() << L"Недостаточно денег для уборки!" << endl;
+            return false;
+        }
+        ledger.post(LEDGER_CLEANING, -enclosure->maintenanceCost);
+        enclosure->clean();
+        simOut() << L"Вольер (ID:" << id << L") убран за " << enclosure->maintenanceCost << L" руб." << endl;
+        return true;
+    }
+
+    void showEnclosures() {
+        ensureEntities();
+        simOut() << L"\n=== Список вольеров ===" << endl;
+        if (enclosures.empty()) {
+            simOut() << L"Вольеров нет" << endl;
+            return;
+        }
+        for (size_t i = 0; i < enclosures.size(); i++) {
+            const Enclosure& enclosure = *enclosures[i];
+            simOut() << L"ID:" << enclosure.id << L" | " << enclosure.getTypeName()
+                << L" | Климат: " << enclosure.climate
+                << L" | Животных: " << enclosure.containedAnimals.size() << L"/" << enclosure.capacity
+                << L" | " << (enclosure.isClean ? L"Чистый" : L"Грязный")
+                << L" | От входа: " << layout->entranceMinutes(i) << L" мин" << endl;
+        }
+        simOut() << L"Заполненность по типам:" << endl;
+        for (const auto& info : SpeciesCatalog::instance().enclosureTypes()) {
+            EnclosureType type = info.type;
+            if (aggregates.enclosureCount[type] == 0) continue;
+            simOut() << L"  " << info.name << L": " << aggregates.enclosureCount[type] << L" шт., занято "
+                << aggregates.enclosureOccupancy[type] << L"/" << aggregates.enclosureCapacity[type] << endl;
+        }
+    }
+
+// Карта зоопарка: участки вольеров, дорожки и время пути от входа
+
+    void showMap() {
+        ensureEntities();
+        simOut() << L"\n=== Карта зоопарка ===" << endl;
+        for (const auto& line : layout->render()) simOut() << line << endl;
+        simOut() << L"E - вход, # - дорожки" << endl;
+        for (size_t i = 0; i < enclosures.size(); i++) {
+            simOut() << ZooMap::lotSymbol(i) << L" - вольер ID:" << enclosures[i]->id << L" (" << enclosures[i]->getTypeName()
+                << L"), от входа " << layout->entranceMinutes(i) << L" мин" << endl;
+        }
+    }
+
+    const ZooMap& getLayout() const { return *layout; }
+
+    bool hireWorkerOfType(WorkerType type, const wstring& workerName) {
+        ensureEntities();
+        if (type < WORKER_VET || type > WORKER_GUIDE) return false;
+        const WorkerTypeInfo& info = SpeciesCatalog::instance().worker(type);
+        if (!ledger.canAfford(info.salary)) {
+            simOut() << L"Недостаточно денег для найма!" << endl;
+            return false;
+        }
+        workers.push_back(make_unique<Worker>(nextWorkerId++, workerName, type));
+        workersMap[workers.back()->id] = workers.back().get();
+        staff.add(*workers.back());
+        aggregates.addWorker(*workers.back());
+        simOut() << L"Вы наняли нового работника: " << workerName << L" (" << info.name << L")" << endl;
+        return true;
+    }
+
+    void showWorkers() {
+        ensureEntities();
+        simOut() << L"\n=== Список работников ===" << endl;
+        if (workers.empty()) {
+            simOut() << L"Работников нет" << endl;
+            return;
+        }
+        for (const auto& worker : workers) {
+            simOut() << L"ID:" << worker->id << L" | " << worker->name << L" | "
+                << worker->getTypeName() << L" | Зарплата: " << worker->salary << L" руб./день" << endl;
+        }
+    }
+
+// Общий запас корма всех типов
+
+    int totalFood() const {
+        int total = 0;
+        for (int amount : foodStock) total += amount;
+        return total;
+    }
+
+// Дневная потребность в корме каждого типа по численности видов (O(число видов))
+
+    array<int, FOOD_TYPE_COUNT> dailyFoodNeed() const {
+        array<int, FOOD_TYPE_COUNT> need{};
+        const SpeciesCatalog& catalog = SpeciesCatalog::instance();
+        for (size_t i = 0; i < aggregates.speciesPopulation.size(); i++) {
+            const SpeciesInfo& info = catalog.at(static_cast<int>(i));
+            need[info.diet] += aggregates.speciesPopulation[i] * info.dailyRation;
+        }
+        return need;
+    }
+
+// Покупка упаковки корма (1 - маленькая, 2 - средняя, 3 - большая) заданного типа
+
+    bool purchaseFood(int choice, FoodType type) {
+        if (choice < 1 || choice > 3) return false;
+        if (type < FOOD_MEAT || type >= FOOD_TYPE_COUNT) return false;
+
+        int amount = 0;
+        int cost = 0;
+        switch (choice) {
+        case 1: amount = 50; cost = 5000; break;
+        case 2: amount = 100; cost = 9000; break;
+        case 3: amount = 200; cost = 16000; break;
+        }
+
+        if (!ledger.canAfford(cost)) {
+            simOut() << L"Недостаточно денег для покупки!" << endl;
+            return false;
+        }
+        if (foodStock[type] > numeric_limits<int>::max() - amount) {
+            simOut() << L"Склад корма заполнен!" << endl;
+            return false;
+        }
+
+        foodStock[type] += amount;
+        ledger.post(LEDGER_FOOD, -cost);
+        simOut() << L"Вы купили " << amount << L" единиц корма (" << foodTypeNames[type] << L") за " << cost << L" руб." << endl;
+        return true;
+    }
+
+// Заказ рекламы (1 - бюджетная, 2 - стандартная, 3 - широкая кампания)
+
+    bool orderAdvertising(int choice) {
+        if (choice < 1 || choice > 3) return false;
+
+        int popIncrease = 0;
+        int cost = 0;
+        switch (choice) {
+        case 1: popIncrease = 1; cost = 5000; break;
+        case 2: popIncrease = 3; cost = 15000; break;
+        case 3: popIncrease = 7; cost = 30000; break;
+        }
+
+        if (!ledger.canAfford(cost)) {
+            simOut() << L"Недостаточно денег для рекламы!" << endl;
+            return false;
+        }
+
+        popularity += popIncrease;
+        ledger.post(LEDGER_ADVERTISING, -cost);
+        simOut() << L"Рекламная кампания успешно проведена! Популярность увеличилась на " << popIncrease << L"." << endl;
+        return true;
+    }
+
+    void showAnimalHappiness() {
+        ensureEntities();
+        simOut() << L"\n=== Уровень счастья животных ===" << endl;
+        if (animals.empty()) {
+            simOut() << L"Животных нет" << endl;
+            return;
+        }
+        for (const auto& animal : animals) {
+            const wchar_t* genderStr = (animal->gender == 'M') ? L"Самец" : L"Самка";
+            simOut() << animal->name << L" (" << genderStr << L", ID:" << animal->id << L") - "
+                << animal->getHappinessColor() << animal->getDisplayedHappiness() << L"%"
+                << terminalColorCodes[COLOR_DEFAULT] << endl;
+        }
+    }
+
+    bool refreshMarketForMoney() {
+        if (!ledger.canAfford(marketRefreshCost)) {
+            simOut() << L"Недостаточно денег для обновления рынка!" << endl;
+            return false;
+        }
+        ledger.post(LEDGER_MARKET, -marketRefreshCost);
+        refreshMarket();
+        return true;
+    }
+
+// Выполнение команды игрока без консольного ввода
+
+    bool execute(const ZooCommand& command) {
+        ensureEntities();
+        if (gameOver) return false;
+        if (command.type == ZooCommandType::NEXT_DAY) {
+            nextDay();
+            return true;
+        }
+
+        bool done = false;
+        switch (command.type) {
+        case ZooCommandType::BUY_ANIMAL: done = purchaseAnimal(command.arg1); break;
+        case ZooCommandType::SELL_ANIMAL: done = sellAnimalById(command.arg1); break;
+        case ZooCommandType::RENAME_ANIMAL: done = renameAnimalById(command.arg1, command.text); break;
+        case ZooCommandType::BREED_ANIMALS: done = breedAnimals(command.arg1, command.arg2); break;
+        case ZooCommandType::REFRESH_MARKET: done = refreshMarketForMoney(); break;
+        case ZooCommandType::BUY_ENCLOSURE: done = purchaseEnclosure(command.arg1, command.text); break;
+        case ZooCommandType::HIRE_WORKER: done = hireWorkerOfType(static_cast<WorkerType>(command.arg1), command.text); break;
+        case ZooCommandType::BUY_FOOD: done = purchaseFood(command.arg1, static_cast<FoodType>(command.arg2)); break;
+        case ZooCommandType::ADVERTISE: done = orderAdvertising(command.arg1); break;
+        case ZooCommandType::CLEAN_ENCLOSURE: done = cleanEnclosureById(command.arg1); break;
+        case ZooCommandType::FAST_FORWARD: return fastForward(command.arg1).days > 0;
+        default: break;
+        }
+        if (done) journalChanges(0);
+        return done;
+    }
+
+// Подключение журнала изменений (см. ZooJournal)
+
+    void attachJournal(ZooJournal* target);
+
+// Запись изменений в журнал, если он подключен (после дней или действия игрока,
+// ageTicks - сколько дней прошло с прошлой записи)
+
+    void journalChanges(int ageTicks);
+
+// Подключение модели посетителей (nullptr - простая формула: посетители от популярности).
+// Ветки fork() держат модель вместе с исходным зоопарком
+
+    void attachVisitorEngine(shared_ptr<VisitorEngine> engine) { visitorEngine = move(engine); }
+    bool hasVisitorEngine() const { return visitorEngine != nullptr; }
+
+// Смена персонала по тикам заданной длины (0 - выключена)
+
+    void setShiftTicks(int tickMinutes) { shiftTickMinutes = max(0, min(tickMinutes, static_cast<int>(StaffRoute::shiftMinutes))); }
+    int getShiftTicks() const { return shiftTickMinutes; }
+
+// День модели посетителей: привлекательность вольеров по видам и счастью животных
+
+    VisitorDayResult simulateVisitors();
+
+    void nextDay() {
+        if (gameOver) return;
+        simulateDay();
+        maintainAnimalStorage();
+        journalChanges(1);
+    }
+
+// Обслуживание между днями: раз в неделю животные основного зоопарка дефрагментируются, если
+// больше четверти соседних жильцов вольеров лежат в хранилище не подряд. Ветки (прогнозы
+// советника, ветки перемотки) не тратят на это время и не забирают копии общих животных
+
+    void maintainAnimalStorage() {
+        if (isBranch) return;
+        if (days % 7 == 0 && animalFragmentation() > 0.25) defragmentAnimals();
+    }
+
+// Перемотка до дня targetDay или до события, о котором стоит сказать игроку: гибели или побега
+// животного, ухода работников, нехватки корма, конца игры (день с событием проходит целиком).
+// Дни идут без вывода. Утро дня без больных не обходит всех животных: прибавка возраста
+// копится и переносится в животных перед днем с больными и в конце перемотки, кандидаты
+// в заболевшие выбираются пропусками по геометрическому распределению с наибольшим шансом
+// и заболевают с долей своего шанса, проверку старости проходят только животные, пережившие
+// предельный возраст. В журнал пишется один кадр
+
+    FastForwardResult fastForward(int targetDay) {
+        ensureEntities();
+        FastForwardResult result;
+        if (gameOver) {
+            result.stop = FastForwardStop::GAME_OVER;
+            return result;
+        }
+
+        int pendingAge = 0;
+        // Животные по числу дней до предельного возраста (без pendingAge), первые rollers его пережили
+        vector<Animal*> byAgeMargin;
+        size_t rollers = 0;
+        auto applyPendingAge = [&]() {
+            if (pendingAge > 0) {
+                for (auto& animal : animals) animal->age += pendingAge;
+            }
+            pendingAge = 0;
+            byAgeMargin.clear();
+        };
+
+        try {
+            SimOutputScope quiet(quietStream());
+            while (days < targetDay) {
+                int alive = aggregates.aliveAnimals;
+                size_t staffSize = workers.size();
+                bool quietDay = aggregates.sickAnimals == 0;
+                beginDay();
+                if (quietDay) {
+                    if (byAgeMargin.empty()) {
+                        for (auto& animal : animals) byAgeMargin.push_back(animal.get());
+                        sort(byAgeMargin.begin(), byAgeMargin.end(), [](const Animal* a, const Animal* b) {
+                            return a->maxAge - a->age < b->maxAge - b->age;
+                        });
+                        rollers = 0;
+                    }
+                    pendingAge++;
+                    while (rollers < byAgeMargin.size() && byAgeMargin[rollers]->maxAge - byAgeMargin[rollers]->age < pendingAge) {
+                        rollers++;
+                    }
+
+                    geometric_distribution<size_t> skip(Animal::maxInfectionChance / 1000.0);
+                    for (size_t i = skip(simRandomEngine()); i < animals.size(); i += 1 + skip(simRandomEngine())) {
+                        Animal& animal = *animals[i];
+                        if (simRand() % Animal::maxInfectionChance >= animal.infectionChance()) continue;
+                        ZooAggregates::AnimalState before = ZooAggregates::stateOf(animal);
+                        if (!animal.infect()) continue;
+                        if (animal.home) animal.home->happinessDirty = true;
+                        aggregates.changeAnimal(animal, before);
+                    }
+
+                    unordered_set<const Animal*> diedOfAge;
+                    for (size_t i = 0; i < rollers; i++) {
+                        Animal& animal = *byAgeMargin[i];
+                        ZooAggregates::AnimalState before = ZooAggregates::stateOf(animal);
+                        animal.age += pendingAge;
+                        if (animal.checkAge()) {
+                            aggregates.changeAnimal(animal, before);
+                            forgetAnimal(animal);
+                            diedOfAge.insert(&animal);
+                        }
+                        else {
+                            animal.age -= pendingAge;
+                        }
+                    }
+                    if (!diedOfAge.empty()) {
+                        animals.erase(remove_if(animals.begin(), animals.end(),
+                            [&](const unique_ptr<Animal>& a) { return diedOfAge.count(a.get()) > 0; }), animals.end());
+                        byAgeMargin.clear();
+                    }
+
+                    // Без больных в вольерах меняется только чистота
+                    if (aggregates.sickAnimals > 0) {
+                        updateEnclosures();
+                    }
+                    else {
+                        for (auto& enclosure : enclosures) enclosure->updateCleanliness();
+                    }
+                    result.quietDays++;
+                }
+                else {
+                    applyPendingAge();
+                    ageAnimals();
+                    updateEnclosures();
+                }
+                finishDay();
+                result.days++;
+
+                if (gameOver) result.stop = FastForwardStop::GAME_OVER;
+                else if (aggregates.aliveAnimals < alive) result.stop = FastForwardStop::ANIMAL_LOST;
+                else if (workers.size() < staffSize) result.stop = FastForwardStop::STAFF_LEFT;
+                else if (find(dietFed.begin(), dietFed.end(), false) != dietFed.end()) result.stop = FastForwardStop::FOOD_SHORTAGE;
+                if (result.stop != FastForwardStop::TARGET_DAY) break;
+            }
+        }
+        catch (const std::bad_alloc& e) {
+            simOut() << L"Ошибка памяти! Слишком много объектов." << endl;
+            simOut() << L"Попробуйте продать некоторых животных или уволить работников." << endl;
+        }
+        catch (const std::exception& e) {
+            simOut() << L"Ошибка: " << e.what() << endl;
+        }
+        applyPendingAge();
+        if (result.days > 0) {
+            maintainAnimalStorage();
+            journalChanges(result.days);
+        }
+        return result;
+    }
+
+// Расчет одного дня без записи в журнал
+
+    void simulateDay() {
+        ensureEntities();
+        try {
+            beginDay();
+            ageAnimals();
+            updateEnclosures();
+            finishDay();
+        }
+        catch (const std::bad_alloc& e) {
+            simOut() << L"Ошибка памяти! Слишком много объектов." << endl;
+            simOut() << L"Попробуйте продать некоторых животных или уволить работников." << endl;
+        }
+        catch (const std::exception& e) {
+            simOut() << L"Ошибка: " << e.what() << endl;
+        }
+    }
+
+    void payWorkers() {
+        ensureEntities();
+        long long totalSalary = aggregates.salaryTotal;
+        if (!ledger.canAfford(totalSalary)) {
+            simOut() << L"Недостаточно денег для выплаты зарплат! Работники увольняются." << endl;
+            workers.clear();
+            workersMap.clear();
+            staff.clear();
+            aggregates.salaryTotal = 0;
+            return;
+        }
+
+        ledger.post(LEDGER_SALARIES, -totalSalary);
+        simOut() << L"Выплачено зарплат работникам: " << totalSalary << L" руб." << endl;
+    }
+
+// Запись показателей текущего дня в историю
+
+    void recordHistory() {
+        ensureEntities();
+        kpiRow.assign(KPI_SPECIES_FIRST + SpeciesCatalog::instance().size(), 0.0);
+        const ZooLedger::DayBatch& today = ledger.pending();
+        kpiRow[KPI_MONEY] = static_cast<double>(ledger.balance());
+        kpiRow[KPI_FOOD] = totalFood();
+        kpiRow[KPI_POPULARITY] = popularity;
+        kpiRow[KPI_VISITORS] = visitors;
+        kpiRow[KPI_INCOME] = static_cast<double>(today.amount[LEDGER_VISITORS] + today.amount[LEDGER_TOURS]);
+        kpiRow[KPI_SALARIES] = static_cast<double>(-today.amount[LEDGER_SALARIES]);
+
+        kpiRow[KPI_HEALTHY] = aggregates.aliveAnimals - aggregates.sickAnimals;
+        kpiRow[KPI_SICK] = aggregates.sickAnimals;
+        kpiRow[KPI_DEAD] = aggregates.deadAnimals;
+        for (size_t i = 0; i < aggregates.speciesPopulation.size(); i++) {
+            kpiRow[KPI_SPECIES_FIRST + i] = aggregates.speciesPopulation[i];
+        }
+        kpiRow[KPI_AVERAGE_HAPPINESS] = aggregates.aliveAnimals > 0
+            ? static_cast<double>(aggregates.happinessTotal) / aggregates.aliveAnimals : 0.0;
+        history.record(days, kpiRow);
+    }
+
+// Отображение истории показателей: последние дни, недели и месяцы
+
+    void showHistory() {
+        simOut() << L"\n=== История показателей ===" << endl;
+        const KpiRing& daily = history.ring(KpiResolution::DAY);
+        if (daily.size() == 0) {
+            simOut() << L"История пока пуста" << endl;
+            return;
+        }
+
+        auto printRows = [&](const wstring& title, KpiResolution resolution, size_t maxRows) {
+            const KpiRing& source = history.ring(resolution);
+            if (source.size() == 0) return;
+            simOut() << title << endl;
+            for (size_t i = source.size() > maxRows ? source.size() - maxRows : 0; i < source.size(); i++) {
+                simOut() << L"День " << source.dayAt(i)
+                    << L" | Баланс: " << static_cast<long long>(source.valueAt(KPI_MONEY, i)) << L" руб."
+                    << L" | Еда: " << static_cast<long long>(source.valueAt(KPI_FOOD, i))
+                    << L" | Популярность: " << static_cast<long long>(source.valueAt(KPI_POPULARITY, i))
+                    << L" | Доход: " << static_cast<long long>(source.valueAt(KPI_INCOME, i))
+                    << L" | Зарплаты: " << static_cast<long long>(source.valueAt(KPI_SALARIES, i))
+                    << L" | Больных: " << static_cast<long long>(source.valueAt(KPI_SICK, i))
+                    << L" | Счастье: " << fixed << setprecision(1) << source.valueAt(KPI_AVERAGE_HAPPINESS, i) << L"%" << endl;
+            }
+        };
+        printRows(L"Последние дни:", KpiResolution::DAY, 7);
+        printRows(L"Недели (средние значения):", KpiResolution::WEEK, 4);
+        printRows(L"Месяцы (средние значения):", KpiResolution::MONTH, 6);
+    }
+
+// Отчет о финансах по статьям: операции текущего дня, последний закрытый день и вся игра
+
+    void showFinances() {
+        simOut() << L"\n=== Финансы ===" << endl;
+        simOut() << L"Баланс: " << ledger.balance() << L" руб." << endl;
+        const ZooLedger::DayBatch& today = ledger.pending();
+        const ZooLedger::DayBatch& closed = ledger.closedDay();
+        for (int category = 0; category < LEDGER_CATEGORY_COUNT; category++) {
+            if (today.entries[category] == 0 && closed.entries[category] == 0 && ledger.totals()[category] == 0) continue;
+            simOut() << ledgerCategoryNames[category]
+                << L" | Сегодня: " << today.amount[category] << L" (" << today.entries[category] << L" оп.)"
+                << L" | Вчера: " << closed.amount[category] << L" (" << closed.entries[category] << L" оп.)"
+                << L" | За игру: " << ledger.totals()[category] << endl;
+        }
+        simOut() << L"Вчера доходы: " << closed.income() << L" руб., расходы: " << closed.expenses() << L" руб." << endl;
+    }
+
+// Оценка памяти, занимаемой зоопарком (объекты, строки, контейнеры и индексы)
+
+    size_t memoryUsage() const {
+        auto animalBytes = [](const Animal& animal) {
+            return sizeof(Animal) + heapBytes(animal.name) + heapBytes(animal.species) + heapBytes(animal.climate);
+        };
+        auto mapBytes = [](size_t buckets, size_t entries, size_t entrySize) {
+            return buckets * sizeof(void*) + entries * (entrySize + 2 * sizeof(void*));
+        };
+
+        size_t total = sizeof(Zoo) + heapBytes(name) + heapBytes(directorName);
+        total += (animals.capacity() + marketAnimals.capacity()) * sizeof(unique_ptr<Animal>);
+        for (const auto& animal : animals) total += animalBytes(*animal);
+        for (const auto& animal : marketAnimals) total += animalBytes(*animal);
+        total += enclosures.capacity() * sizeof(unique_ptr<Enclosure>);
+        for (const auto& enclosure : enclosures) {
+            total += sizeof(Enclosure) + heapBytes(enclosure->climate) + enclosure->containedAnimals.capacity() * sizeof(Animal*);
+        }
+        total += workers.capacity() * sizeof(unique_ptr<Worker>);
+        for (const auto& worker : workers) total += sizeof(Worker) + heapBytes(worker->name);
+        total += mapBytes(animalsMap.bucket_count(), animalsMap.size(), sizeof(pair<const int, Animal*>));
+        total += mapBytes(enclosuresMap.bucket_count(), enclosuresMap.size(), sizeof(pair<const int, Enclosure*>));
+        total += mapBytes(workersMap.bucket_count(), workersMap.size(), sizeof(pair<const int, Worker*>));
+        total += history.memoryUsage() + kpiRow.capacity() * sizeof(double) + layout->memoryUsage();
+        if (contactGraph) total += contactGraph->memoryUsage();
+        if (hibernated) {
+            total += sizeof(HibernatedAnimals) + hibernated->animals.memoryUsage() + hibernated->market.memoryUsage();
+            for (const auto& members : hibernated->enclosureMembers) total += sizeof(members) + members.capacity() * sizeof(uint32_t);
+        }
+        return total;
+    }
+
+// Освобождение лишней емкости контейнеров у простаивающего зоопарка
+
+    void trimMemory() {
+        animals.shrink_to_fit();
+        marketAnimals.shrink_to_fit();
+        enclosures.shrink_to_fit();
+        workers.shrink_to_fit();
+        for (auto& enclosure : enclosures) enclosure->containedAnimals.shrink_to_fit();
+        animalsMap.rehash(0);
+        enclosuresMap.rehash(0);
+        workersMap.rehash(0);
+    }
+};
+
+// Двоичная запись и чтение для журнала и снимков (little-endian, строки - по символу на 4 байта)
+
+class ByteWriter {
+public:
+    vector<uint8_t> bytes;
+
+    void u8(uint8_t value) { bytes.push_back(value); }
+
+    void u32(uint32_t value) {
+        for (int i = 0; i < 4; i++) bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void u64(uint64_t value) {
+        for (int i = 0; i < 8; i++) bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+
+    void i32(int value) { u32(static_cast<uint32_t>(value)); }
+    void i64(long long value) { u64(static_cast<uint64_t>(value)); }
+
+    void str(const wstring& value) {
+        u32(static_cast<uint32_t>(value.size()));
+        for (wchar_t ch : value) u32(static_cast<uint32_t>(ch));
+    }
+};
+
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : data(data), size(size), position(0), ok(true) {}
+
+    bool good() const { return ok; }
+    bool atEnd() const { return position >= size; }
+
+    uint8_t u8() {
+        if (!require(1)) return 0;
+        return data[position++];
+    }
+
+    uint32_t u32() {
+        if (!require(4)) return 0;
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++) value |= static_cast<uint32_t>(data[position++]) << (8 * i);
+        return value;
+    }
+
+    uint64_t u64() {
+        if (!require(8)) return 0;
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) value |= static_cast<uint64_t>(data[position++]) << (8 * i);
+        return value;
+    }
+
+    int i32() { return static_cast<int>(u32()); }
+    long long i64() { return static_cast<long long>(u64()); }
+
+    wstring str() {
+        uint32_t length = u32();
+        if (!require(static_cast<size_t>(length) * 4)) return wstring();
+        wstring value(length, L' ');
+        for (uint32_t i = 0; i < length; i++) value[i] = static_cast<wchar_t>(u32());
+        return value;
+    }
+
+private:
+    const uint8_t* data;
+    size_t size;
+    size_t position;
+    bool ok;
+
+    bool require(size_t count) {
+        if (!ok || size - position < count) ok = false;
+        return ok;
+    }
+};
+
+// Контрольная сумма записи (FNV-1a)
+
+uint32_t journalChecksum(const uint8_t* data, size_t size) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Класс ZooJournal: журнал упреждающей записи для зоопарка.
+// После каждого дня и каждого действия игрока в журнал дописывается кадр с изменениями:
+// скаляры зоопарка, изменившиеся возраст/счастье/здоровье животных, рождения и покупки,
+// удаления, вольеры, работники и рынок. Запись в файл идет последовательно в фоновом потоке.
+// Каждая запись имеет длину и контрольную сумму, поэтому после сбоя восстановление
+// останавливается на первой оборванной записи: снимок + корректный хвост журнала.
+// Файлы не синхронизируются с диском (fsync/FlushFileBuffers), поэтому согласованность
+// гарантирована только после падения процесса, а не после сбоя ОС или отключения питания.
+// Если запись снимка не удалась, старый снимок и журнал остаются; если не удалось дописать
+// кадр, следующие кадры не пишутся, а следующий capture() записывает полный снимок
+
+class ZooJournal {
+public:
+    explicit ZooJournal(string basePath, int checkpointEvery = 100)
+        : basePath(move(basePath)), checkpointEvery(checkpointEvery), sequence(0), framesSinceCheckpoint(0),
+        zoo(nullptr), stopping(false), writing(false) {
+        writer = thread([this]() { writerLoop(); });
+    }
+
+    ~ZooJournal() {
+        detach();
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueReady.notify_all();
+        writer.join();
+    }
+
+    ZooJournal(const ZooJournal&) = delete;
+    ZooJournal& operator=(const ZooJournal&) = delete;
+
+// Подключение журнала к зоопарку: сразу записывается снимок, от которого пойдут кадры
+
+    void attach(Zoo& target);
+
+    void detach();
+
+// Запись изменений с момента предыдущего кадра (ageTicks - сколько дней прошло с него)
+
+    void capture(Zoo& target, int ageTicks);
+
+// Полный снимок состояния; журнал после него начинается заново
+
+    void checkpoint(Zoo& target);
+
+// Ожидание, пока фоновый поток запишет все кадры
+
+    void flush() {
+        unique_lock<mutex> lock(queueMutex);
+        queueIdle.wait(lock, [this]() { return pending.empty() && !writing; });
+    }
+
+// Была ли ошибка записи снимка или журнала с момента создания
+
+    bool hasWriteError() const { return writeError.load(); }
+
+    static bool hasSavedGame(const string& basePath) {
+        return ifstream(basePath + ".snapshot", ios::binary).good() || ifstream(basePath + ".snapshot.tmp", ios::binary).good();
+    }
+
+// Восстановление зоопарка: последний корректный снимок и кадры журнала после него
+
+    static unique_ptr<Zoo> recover(const string& basePath);
+
+// Проверка восстановления после падения процесса на каждом шаге записи: запись временного
+// снимка, удаление старого снимка, переименование, очистка журнала и оборванный кадр.
+// Проверочный зоопарк пишется в файлы basePath.*, которые потом удаляются.
+// Возвращает true, если recover() во всех случаях вернул последнее записанное состояние
+
+    static bool verifyCrashRecovery(const string& basePath);
+
+private:
+    // Записи с 32-битным балансом (типы 1 и 2) не читаются: их восстановление дало бы неверные деньги.
+    // Записи без геномов животных (типы 3 и 4) тоже не читаются
+
+    enum RecordType : uint8_t { RECORD_FRAME = 5, RECORD_SNAPSHOT = 6 };
+
+    // OP_AGE_TICK (один день) пишется старыми версиями и только читается; новые кадры
+    // записывают число дней один раз через OP_AGE_TICKS
+
+    enum FrameOp : uint8_t {
+        OP_END, OP_AGE_TICK, OP_ANIMAL_ADDED, OP_ANIMAL_STATE, OP_ANIMAL_RENAMED, OP_ANIMAL_REMOVED,
+        OP_ENCLOSURE_ADDED, OP_ENCLOSURE_STATE, OP_WORKER_ADDED, OP_WORKER_REMOVED, OP_MARKET, OP_AGE_TICKS
+    };
+
+    enum AnimalField : uint8_t { FIELD_AGE = 1, FIELD_HAPPINESS = 2, FIELD_HEALTH = 4 };
+
+    // Точки, в которых verifyCrashRecovery "убивает" процесс: после них фоновый поток
+    // больше не трогает файлы, как будто процесс завершился (данные без fsync уже у ОС)
+
+    enum CrashPoint : uint8_t {
+        CRASH_NONE, CRASH_SNAPSHOT_WRITTEN, CRASH_SNAPSHOT_REMOVED, CRASH_SNAPSHOT_RENAMED, CRASH_JOURNAL_TRUNCATED,
+        CRASH_FRAME_TORN
+    };
+
+    struct AnimalShadow {
+        int age;
+        int trueHappiness;
+        int displayedHappiness;
+        AnimalHealth health;
+        int daysSick;
+        bool hasDisease;
+        bool isAlive;
+        wstring name;
+    };
+
+    struct ZooScalars {
+        int days;
+        long long money;
+        array<int, FOOD_TYPE_COUNT> food;
+        int popularity, visitors, victoryDays;
+        int nextAnimalId, nextEnclosureId, nextWorkerId, animalsBoughtToday;
+        bool gameOver;
+    };
+
+    struct PendingWrite {
+        bool snapshot;
+        vector<uint8_t> bytes;
+    };
+
+    string basePath;
+    int checkpointEvery;
+    uint64_t sequence;
+    int framesSinceCheckpoint;
+    Zoo* zoo;
+
+    ZooScalars scalarShadow{};
+    unordered_map<int, AnimalShadow> animalShadow;
+    unordered_map<int, bool> enclosureShadow;
+    set<int> workerShadow;
+    vector<int> marketShadow;
+
+    thread writer;
+    mutex queueMutex;
+    condition_variable queueReady;
+    condition_variable queueIdle;
+    deque<PendingWrite> pending;
+    bool stopping;
+    bool writing;
+    atomic<bool> writeError{ false };
+    atomic<bool> snapshotNeeded{ false };
+    atomic<CrashPoint> crashAt{ CRASH_NONE };
+
+    static ZooScalars scalarsOf(const Zoo& target);
+    static bool sameScalars(const ZooScalars& left, const ZooScalars& right);
+    static void writeScalars(ByteWriter& out, const ZooScalars& scalars);
+    static ZooScalars readScalars(ByteReader& in);
+    static void applyScalars(Zoo& target, const ZooScalars& scalars);
+    static void writeAnimal(ByteWriter& out, const Animal& animal);
+    static unique_ptr<Animal> readAnimal(ByteReader& in);
+    static void writeEnclosure(ByteWriter& out, const Enclosure& enclosure);
+    static unique_ptr<Enclosure> readEnclosure(ByteReader& in);
+    static void writeWorker(ByteWriter& out, const Worker& worker);
+    static unique_ptr<Worker> readWorker(ByteReader& in);
+    static void writeState(ByteWriter& out, const Zoo& target);
+    static bool readSnapshot(const string& path, unique_ptr<Zoo>& result, uint64_t& snapshotSequence);
+    static bool applyFrame(Zoo& target, ByteReader& in);
+
+    void rememberState(Zoo& target);
+
+    void enqueue(bool snapshot, const ByteWriter& record) {
+        PendingWrite write{ snapshot, vector<uint8_t>() };
+        write.bytes.reserve(record.bytes.size() + 8);
+        ByteWriter header;
+        header.u32(static_cast<uint32_t>(record.bytes.size()));
+        header.u32(journalChecksum(record.bytes.data(), record.bytes.size()));
+        write.bytes.insert(write.bytes.end(), header.bytes.begin(), header.bytes.end());
+        write.bytes.insert(write.bytes.end(), record.bytes.begin(), record.bytes.end());
+        {
+            lock_guard<mutex> lock(queueMutex);
+            pending.push_back(move(write));
+        }
+        queueReady.notify_one();
+    }
+
+    void writeFailed(bool needSnapshot) {
+        writeError = true;
+        if (needSnapshot) snapshotNeeded = true;
+    }
+
+    void writerLoop() {
+        ofstream journalFile;
+        // Кадр не дописан: журнал нельзя продолжать до следующего удачного снимка
+        bool journalBroken = false;
+        // Процесс "убит" в точке crashAt: дальше записи только выбрасываются
+        bool crashed = false;
+        auto crashHere = [&](CrashPoint point) {
+            crashed = crashAt.load() == point;
+            return crashed;
+        };
+        while (true) {
+            deque<PendingWrite> batch;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                queueReady.wait(lock, [this]() { return stopping || !pending.empty(); });
+                if (pending.empty() && stopping) return;
+                batch.swap(pending);
+                writing = true;
+            }
+            for (auto& write : batch) {
+                if (crashed) continue;
+                if (write.snapshot) {
+                    // Снимок пишется во временный файл и заменяет старый; журнал начинается заново
+                    string snapshotPath = basePath + ".snapshot";
+                    string temporaryPath = snapshotPath + ".tmp";
+                    ofstream snapshotFile(temporaryPath, ios::binary | ios::trunc);
+                    snapshotFile.write(reinterpret_cast<const char*>(write.bytes.data()), write.bytes.size());
+                    snapshotFile.close();
+                    if (snapshotFile.fail()) {
+                        std::remove(temporaryPath.c_str());
+                        writeFailed(journalBroken);
+                        continue;
+                    }
+                    if (crashHere(CRASH_SNAPSHOT_WRITTEN)) continue;
+                    std::remove(snapshotPath.c_str());
+                    if (crashHere(CRASH_SNAPSHOT_REMOVED)) continue;
+                    if (std::rename(temporaryPath.c_str(), snapshotPath.c_str()) != 0) writeFailed(false);
+                    if (crashHere(CRASH_SNAPSHOT_RENAMED)) continue;
+                    journalFile.close();
+                    journalFile.open(basePath + ".journal", ios::binary | ios::trunc);
+                    journalBroken = !journalFile.is_open();
+                    if (journalBroken) writeFailed(true);
+                    crashHere(CRASH_JOURNAL_TRUNCATED);
+                    continue;
+                }
+                if (journalBroken) continue;
+                if (!journalFile.is_open()) journalFile.open(basePath + ".journal", ios::binary | ios::app);
+                if (crashHere(CRASH_FRAME_TORN)) {
+                    journalFile.write(reinterpret_cast<const char*>(write.bytes.data()), write.bytes.size() / 2);
+                    journalFile.flush();
+                    continue;
+                }
+                journalFile.write(reinterpret_cast<const char*>(write.bytes.data()), write.bytes.size());
+                if (!journalFile) {
+                    journalBroken = true;
+                    writeFailed(true);
+                }
+            }
+            if (journalFile.is_open() && !journalBroken && !crashed && !journalFile.flush()) {
+                journalBroken = true;
+                writeFailed(true);
+            }
+            {
+                lock_guard<mutex> lock(queueMutex);
+                writing = false;
+            }
+            queueIdle.notify_all();
+        }
+    }
+};
+
+// Подключение журнала к зоопарку
+
+void Zoo::attachJournal(ZooJournal* target) {
+    journal = target;
+}
+
+void Zoo::journalChanges(int ageTicks) {
+    if (journal) journal->capture(*this, ageTicks);
+}
+
+void ZooJournal::attach(Zoo& target) {
+    detach();
+    zoo = &target;
+    target.attachJournal(this);
+    checkpoint(target);
+}
+
+void ZooJournal::detach() {
+    if (!zoo) return;
+    zoo->attachJournal(nullptr);
+    zoo = nullptr;
+    flush();
+}
+
+ZooJournal::ZooScalars ZooJournal::scalarsOf(const Zoo& target) {
+    return ZooScalars{ target.days, target.ledger.balance(), target.foodStock, target.popularity, target.visitors, target.victoryDays,
+        target.nextAnimalId, target.nextEnclosureId, target.nextWorkerId, target.animalsBoughtToday, target.gameOver };
+}
+
+bool ZooJournal::sameScalars(const ZooScalars& left, const ZooScalars& right) {
+    return left.days == right.days && left.money == right.money && left.food == right.food &&
+        left.popularity == right.popularity && left.visitors == right.visitors && left.victoryDays == right.victoryDays &&
+        left.nextAnimalId == right.nextAnimalId && left.nextEnclosureId == right.nextEnclosureId &&
+        left.nextWorkerId == right.nextWorkerId && left.animalsBoughtToday == right.animalsBoughtToday &&
+        left.gameOver == right.gameOver;
+}
+
+void ZooJournal::writeScalars(ByteWriter& out, const ZooScalars& scalars) {
+    out.i32(scalars.days);
+    out.i64(scalars.money);
+    for (int amount : scalars.food) out.i32(amount);
+    for (int value : { scalars.popularity, scalars.visitors, scalars.victoryDays,
+        scalars.nextAnimalId, scalars.nextEnclosureId, scalars.nextWorkerId, scalars.animalsBoughtToday }) {
+        out.i32(value);
+    }
+    out.u8(scalars.gameOver ? 1 : 0);
+}
+
+ZooJournal::ZooScalars ZooJournal::readScalars(ByteReader& in) {
+    ZooScalars scalars{};
+    scalars.days = in.i32();
+    scalars.money = in.i64();
+    for (int& amount : scalars.food) amount = in.i32();
+    scalars.popularity = in.i32();
+    scalars.visitors = in.i32();
+    scalars.victoryDays = in.i32();
+    scalars.nextAnimalId = in.i32();
+    scalars.nextEnclosureId = in.i32();
+    scalars.nextWorkerId = in.i32();
+    scalars.animalsBoughtToday = in.i32();
+    scalars.gameOver = in.u8() != 0;
+    return scalars;
+}
+
+void ZooJournal::applyScalars(Zoo& target, const ZooScalars& scalars) {
+    target.days = scalars.days;
+    target.ledger.reset(scalars.money);
+    target.foodStock = scalars.food;
+    target.popularity = scalars.popularity;
+    target.visitors = scalars.visitors;
+    target.victoryDays = scalars.victoryDays;
+    target.nextAnimalId = scalars.nextAnimalId;
+    target.nextEnclosureId = scalars.nextEnclosureId;
+    target.nextWorkerId = scalars.nextWorkerId;
+    target.animalsBoughtToday = scalars.animalsBoughtToday;
+    target.gameOver = scalars.gameOver;
+}
+
+void ZooJournal::writeAnimal(ByteWriter& out, const Animal& animal) {
+    out.i32(animal.id);
+    out.str(animal.name);
+    out.str(animal.species);
+    out.i32(animal.age);
+    out.i32(animal.weight);
+    out.str(animal.climate);
+    out.u8(animal.isPredator ? 1 : 0);
+    out.i32(animal.price);
+    out.u32(static_cast<uint32_t>(animal.gender));
+    out.u8(animal.isAlive ? 1 : 0);
+    out.i32(animal.trueHappiness);
+    out.i32(animal.displayedHappiness);
+    out.i32(animal.maxAge);
+    out.i32(animal.parentId1);
+    out.i32(animal.parentId2);
+    out.u8(static_cast<uint8_t>(animal.health));
+    out.i32(animal.daysSick);
+    out.u8(animal.hasDisease ? 1 : 0);
+    out.u32(animal.genome);
+}
+
+unique_ptr<Animal> ZooJournal::readAnimal(ByteReader& in) {
+    int id = in.i32();
+    wstring name = in.str();
+    wstring species = in.str();
+    int age = in.i32();
+    int weight = in.i32();
+    wstring climate = in.str();
+    bool isPredator = in.u8() != 0;
+    int price = in.i32();
+    wchar_t gender = static_cast<wchar_t>(in.u32());
+    bool isAlive = in.u8() != 0;
+    int trueHappiness = in.i32();
+    int displayedHappiness = in.i32();
+    int maxAge = in.i32();
+    int parentId1 = in.i32();
+    int parentId2 = in.i32();
+    uint8_t health = in.u8();
+    int daysSick = in.i32();
+    bool hasDisease = in.u8() != 0;
+    uint32_t genome = in.u32();
+    if (!in.good() || !SpeciesCatalog::instance().find(species) || health > static_cast<uint8_t>(AnimalHealth::DEAD) ||
+        genome > numeric_limits<uint16_t>::max()) {
+        return nullptr;
+    }
+
+    auto animal = make_unique<Animal>(id, name, species, age, weight, climate, isPredator, price, gender, maxAge, parentId1, parentId2,
+        static_cast<int>(genome));
+    animal->name = name;
+    animal->isAlive = isAlive;
+    animal->trueHappiness = trueHappiness;
+    animal->displayedHappiness = displayedHappiness;
+    animal->health = static_cast<AnimalHealth>(health);
+    animal->daysSick = daysSick;
+    animal->hasDisease = hasDisease;
+    return animal;
+}
+
+void ZooJournal::writeEnclosure(ByteWriter& out, const Enclosure& enclosure) {
+    out.i32(enclosure.id);
+    out.i32(enclosure.capacity);
+    out.i32(enclosure.type);
+    out.str(enclosure.climate);
+    out.i32(enclosure.maintenanceCost);
+    out.u8(enclosure.isClean ? 1 : 0);
+}
+
+unique_ptr<Enclosure> ZooJournal::readEnclosure(ByteReader& in) {
+    int id = in.i32();
+    int capacity = in.i32();
+    int type = in.i32();
+    wstring climate = in.str();
+    int maintenanceCost = in.i32();
+    bool isClean = in.u8() != 0;
+    if (!in.good() || type < ENCLOSURE_SMALL || type > ENCLOSURE_PETTING_ZOO) return nullptr;
+    auto enclosure = make_unique<Enclosure>(id, capacity, static_cast<EnclosureType>(type), climate, maintenanceCost);
+    enclosure->isClean = isClean;
+    return enclosure;
+}
+
+void ZooJournal::writeWorker(ByteWriter& out, const Worker& worker) {
+    out.i32(worker.id);
+    out.str(worker.name);
+    out.i32(worker.type);
+    out.i32(worker.salary);
+    out.i32(worker.capacity);
+}
+
+unique_ptr<Worker> ZooJournal::readWorker(ByteReader& in) {
+    int id = in.i32();
+    wstring name = in.str();
+    int type = in.i32();
+    int salary = in.i32();
+    int capacity = in.i32();
+    if (!in.good() || type < WORKER_VET || type > WORKER_GUIDE) return nullptr;
+    auto worker = make_unique<Worker>(id, name, static_cast<WorkerType>(type));
+    worker->salary = salary;
+    worker->capacity = capacity;
+    return worker;
+}
+
+// Запоминание состояния, с которым будет сравниваться следующий кадр
+
+void ZooJournal::rememberState(Zoo& target) {
+    scalarShadow = scalarsOf(target);
+    animalShadow.clear();
+    for (const auto& animal : target.animals) {
+        animalShadow[animal->id] = AnimalShadow{ animal->age, animal->trueHappiness, animal->displayedHappiness,
+            animal->health, animal->daysSick, animal->hasDisease, animal->isAlive, animal->name };
+    }
+    enclosureShadow.clear();
+    for (const auto& enclosure : target.enclosures) enclosureShadow[enclosure->id] = enclosure->isClean;
+    workerShadow.clear();
+    for (const auto& worker : target.workers) workerShadow.insert(worker->id);
+    marketShadow.clear();
+    for (const auto& animal : target.marketAnimals) marketShadow.push_back(animal->id);
+}
+
+// Полное состояние зоопарка в формате снимка (без типа записи и номера)
+
+void ZooJournal::writeState(ByteWriter& out, const Zoo& target) {
+    writeScalars(out, scalarsOf(target));
+    out.str(target.name);
+    out.str(target.directorName);
+
+    out.u32(static_cast<uint32_t>(target.animals.size()));
+    for (const auto& animal : target.animals) writeAnimal(out, *animal);
+    out.u32(static_cast<uint32_t>(target.enclosures.size()));
+    for (const auto& enclosure : target.enclosures) {
+        writeEnclosure(out, *enclosure);
+        out.u32(static_cast<uint32_t>(enclosure->containedAnimals.size()));
+        for (auto animal : enclosure->containedAnimals) out.i32(animal->id);
+    }
+    out.u32(static_cast<uint32_t>(target.workers.size()));
+    for (const auto& worker : target.workers) writeWorker(out, *worker);
+    out.u32(static_cast<uint32_t>(target.marketAnimals.size()));
+    for (const auto& animal : target.marketAnimals) writeAnimal(out, *animal);
+}
+
+void ZooJournal::checkpoint(Zoo& target) {
+    target.ensureEntities();
+    ByteWriter record;
+    record.u8(RECORD_SNAPSHOT);
+    record.u64(++sequence);
+    writeState(record, target);
+
+    enqueue(true, record);
+    rememberState(target);
+    framesSinceCheckpoint = 0;
+}
+
+void ZooJournal::capture(Zoo& target, int ageTicks) {
+    if (&target != zoo) return;
+    if (snapshotNeeded.exchange(false)) {
+        checkpoint(target);
+        return;
+    }
+    target.ensureEntities();
+
+    ByteWriter record;
+    record.u8(RECORD_FRAME);
+    record.u64(sequence + 1);
+    ZooScalars scalars = scalarsOf(target);
+    writeScalars(record, scalars);
+    size_t headerSize = record.bytes.size();
+    int tick = max(0, ageTicks);
+    if (tick > 0) {
+        record.u8(OP_AGE_TICKS);
+        record.u32(static_cast<uint32_t>(tick));
+    }
+
+    // Удаленные животные: их уже нет в карте ID зоопарка
+    for (auto it = animalShadow.begin(); it != animalShadow.end(); ) {
+        if (target.animalsMap.count(it->first)) {
+            ++it;
+            continue;
+        }
+        record.u8(OP_ANIMAL_REMOVED);
+        record.i32(it->first);
+        it = animalShadow.erase(it);
+    }
+
+    // Новые вольеры и изменения чистоты
+    for (const auto& enclosure : target.enclosures) {
+        auto it = enclosureShadow.find(enclosure->id);
+        if (it == enclosureShadow.end()) {
+            record.u8(OP_ENCLOSURE_ADDED);
+            writeEnclosure(record, *enclosure);
+            enclosureShadow[enclosure->id] = enclosure->isClean;
+        }
+        else if (it->second != enclosure->isClean) {
+            record.u8(OP_ENCLOSURE_STATE);
+            record.i32(enclosure->id);
+            record.u8(enclosure->isClean ? 1 : 0);
+            it->second = enclosure->isClean;
+        }
+    }
+
+    // Новые животные (покупки и рождения) вместе с вольером, куда они помещены
+    for (const auto& enclosure : target.enclosures) {
+        for (auto animal : enclosure->containedAnimals) {
+            if (animalShadow.count(animal->id)) continue;
+            record.u8(OP_ANIMAL_ADDED);
+            record.i32(enclosure->id);
+            writeAnimal(record, *animal);
+            animalShadow[animal->id] = AnimalShadow{ animal->age - tick, animal->trueHappiness, animal->displayedHappiness,
+                animal->health, animal->daysSick, animal->hasDisease, animal->isAlive, animal->name };
+        }
+    }
+    for (const auto& animal : target.animals) {
+        if (animalShadow.count(animal->id)) continue;
+        record.u8(OP_ANIMAL_ADDED);
+        record.i32(-1);
+        writeAnimal(record, *animal);
+        animalShadow[animal->id] = AnimalShadow{ animal->age - tick, animal->trueHappiness, animal->displayedHappiness,
+            animal->health, animal->daysSick, animal->hasDisease, animal->isAlive, animal->name };
+    }
+
+    // Изменившиеся столбцы существующих животных; тень обновляется на месте
+    for (const auto& animal : target.animals) {
+        AnimalShadow& shadow = animalShadow[animal->id];
+        uint8_t fields = 0;
+        if (animal->age != shadow.age + tick) fields |= FIELD_AGE;
+        if (animal->trueHappiness != shadow.trueHappiness || animal->displayedHappiness != shadow.displayedHappiness) {
+            fields |= FIELD_HAPPINESS;
+        }
+        if (animal->health != shadow.health || animal->daysSick != shadow.daysSick ||
+            animal->hasDisease != shadow.hasDisease || animal->isAlive != shadow.isAlive) {
+            fields |= FIELD_HEALTH;
+        }
+        if (fields) {
+            record.u8(OP_ANIMAL_STATE);
+            record.i32(animal->id);
+            record.u8(fields);
+            if (fields & FIELD_AGE) record.i32(animal->age);
+            if (fields & FIELD_HAPPINESS) {
+                record.i32(animal->trueHappiness);
+                record.i32(animal->displayedHappiness);
+            }
+            if (fields & FIELD_HEALTH) {
+                record.u8(static_cast<uint8_t>(animal->health));
+                record.i32(animal->daysSick);
+                record.u8(animal->hasDisease ? 1 : 0);
+                record.u8(animal->isAlive ? 1 : 0);
+            }
+            shadow.age = animal->age - tick;
+            shadow.trueHappiness = animal->trueHappiness;
+            shadow.displayedHappiness = animal->displayedHappiness;
+            shadow.health = animal->health;
+            shadow.daysSick = animal->daysSick;
+            shadow.hasDisease = animal->hasDisease;
+            shadow.isAlive = animal->isAlive;
+        }
+        shadow.age += tick;
+        if (animal->name != shadow.name) {
+            record.u8(OP_ANIMAL_RENAMED);
+            record.i32(animal->id);
+            record.str(animal->name);
+            shadow.name = animal->name;
+        }
+    }
+
+    // Работники
+    set<int> currentWorkers;
+    for (const auto& worker : target.workers) {
+        currentWorkers.insert(worker->id);
+        if (!workerShadow.count(worker->id)) {
+            record.u8(OP_WORKER_ADDED);
+            writeWorker(record, *worker);
+        }
+    }
+    for (int id : workerShadow) {
+        if (!currentWorkers.count(id)) {
+            record.u8(OP_WORKER_REMOVED);
+            record.i32(id);
+        }
+    }
+    workerShadow.swap(currentWorkers);
+
+    // Рынок записывается целиком, только если он обновился
+    bool marketChanged = marketShadow.size() != target.marketAnimals.size();
+    for (size_t i = 0; !marketChanged && i < marketShadow.size(); i++) {
+        marketChanged = marketShadow[i] != target.marketAnimals[i]->id;
+    }
+    if (marketChanged) {
+        record.u8(OP_MARKET);
+        record.u32(static_cast<uint32_t>(target.marketAnimals.size()));
+        marketShadow.clear();
+        for (const auto& animal : target.marketAnimals) {
+            writeAnimal(record, *animal);
+            marketShadow.push_back(animal->id);
+        }
+    }
+
+    if (record.bytes.size() == headerSize && sameScalars(scalars, scalarShadow)) return;
+    record.u8(OP_END);
+    scalarShadow = scalars;
+
+    sequence++;
+    enqueue(false, record);
+    if (++framesSinceCheckpoint >= checkpointEvery) checkpoint(target);
+}
+
+bool ZooJournal::readSnapshot(const string& path, unique_ptr<Zoo>& result, uint64_t& snapshotSequence) {
+    ifstream file(path, ios::binary);
+    if (!file) return false;
+    vector<uint8_t> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+    if (bytes.size() < 8) return false;
+    ByteReader header(bytes.data(), 8);
+    uint32_t length = header.u32();
+    uint32_t checksum = header.u32();
+    if (bytes.size() - 8 < length || journalChecksum(bytes.data() + 8, length) != checksum) return false;
+
+    ByteReader in(bytes.data() + 8, length);
+    if (in.u8() != RECORD_SNAPSHOT) return false;
+    snapshotSequence = in.u64();
+    ZooScalars scalars = readScalars(in);
+    wstring zooName = in.str();
+    wstring directorName = in.str();
+    if (!in.good()) return false;
+
+    unique_ptr<Zoo> restored;
+    {
+        SimOutputScope quiet(quietStream());
+        restored = make_unique<Zoo>(zooName, directorName, scalars.victoryDays);
+    }
+    applyScalars(*restored, scalars);
+    restored->marketAnimals.clear();
+
+    uint32_t animalCount = in.u32();
+    for (uint32_t i = 0; i < animalCount && in.good(); i++) {
+        auto animal = readAnimal(in);
+        if (!animal) return false;
+        restored->animals.push_back(move(animal));
+    }
+    restored->updateMaps();
+    uint32_t enclosureCount = in.u32();
+    for (uint32_t i = 0; i < enclosureCount && in.good(); i++) {
+        auto enclosure = readEnclosure(in);
+        if (!enclosure) return false;
+        uint32_t members = in.u32();
+        for (uint32_t m = 0; m < members && in.good(); m++) {
+            Animal* animal = restored->findAnimal(in.i32());
+            if (animal) enclosure->attach(animal);
+        }
+        restored->enclosures.push_back(move(enclosure));
+    }
+    uint32_t workerCount = in.u32();
+    for (uint32_t i = 0; i < workerCount && in.good(); i++) {
+        auto worker = readWorker(in);
+        if (!worker) return false;
+        restored->workers.push_back(move(worker));
+    }
+    uint32_t marketCount = in.u32();
+    for (uint32_t i = 0; i < marketCount && in.good(); i++) {
+        auto animal = readAnimal(in);
+        if (!animal) return false;
+        restored->marketAnimals.push_back(move(animal));
+    }
+    if (!in.good()) return false;
+    restored->updateMaps();
+    result = move(restored);
+    return true;
+}
+
+bool ZooJournal::applyFrame(Zoo& target, ByteReader& in) {
+    applyScalars(target, readScalars(in));
+    while (in.good()) {
+        uint8_t op = in.u8();
+        switch (op) {
+        case OP_END:
+            target.updateMaps();
+            return in.good();
+        case OP_AGE_TICK:
+            for (auto& animal : target.animals) animal->age++;
+            break;
+        case OP_AGE_TICKS: {
+            uint32_t ticks = in.u32();
+            if (!in.good() || ticks > static_cast<uint32_t>(numeric_limits<int>::max())) return false;
+            for (auto& animal : target.animals) animal->age += static_cast<int>(ticks);
+            break;
+        }
+        case OP_ANIMAL_ADDED: {
+            int enclosureId = in.i32();
+            auto animal = readAnimal(in);
+            if (!animal) return false;
+            target.animals.push_back(move(animal));
+            if (Enclosure* enclosure = target.findEnclosure(enclosureId)) {
+                enclosure->attach(target.animals.back().get());
+            }
+            break;
+        }
+        case OP_ANIMAL_STATE: {
+            int id = in.i32();
+            uint8_t fields = in.u8();
+            Animal* found = target.findAnimal(id);
+            if (!found) return false;
+            Animal& animal = *found;
+            if (fields & FIELD_AGE) animal.age = in.i32();
+            if (fields & FIELD_HAPPINESS) {
+                animal.trueHappiness = in.i32();
+                animal.displayedHappiness = in.i32();
+            }
+            if (fields & FIELD_HEALTH) {
+                animal.health = static_cast<AnimalHealth>(in.u8());
+                animal.daysSick = in.i32();
+                animal.hasDisease = in.u8() != 0;
+                animal.isAlive = in.u8() != 0;
+            }
+            if (animal.home) animal.home->happinessDirty = true;
+            break;
+        }
+        case OP_ANIMAL_RENAMED: {
+            int id = in.i32();
+            wstring newName = in.str();
+            if (Animal* animal = target.findAnimal(id)) animal->name = newName;
+            break;
+        }
+        case OP_ANIMAL_REMOVED: {
+            int id = in.i32();
+            for (auto& enclosure : target.enclosures) enclosure->removeAnimal(id);
+            target.animals.erase(remove_if(target.animals.begin(), target.animals.end(),
+                [id](const unique_ptr<Animal>& a) { return a->id == id; }), target.animals.end());
+            break;
+        }
+        case OP_ENCLOSURE_ADDED: {
+            auto enclosure = readEnclosure(in);
+            if (!enclosure) return false;
+            target.enclosures.push_back(move(enclosure));
+            target.updateMaps();
+            break;
+        }
+        case OP_ENCLOSURE_STATE: {
+            int id = in.i32();
+            bool isClean = in.u8() != 0;
+            if (Enclosure* enclosure = target.findEnclosure(id)) {
+                enclosure->isClean = isClean;
+                enclosure->happinessDirty = true;
+            }
+            break;
+        }
+        case OP_WORKER_ADDED: {
+            auto worker = readWorker(in);
+            if (!worker) return false;
+            target.workers.push_back(move(worker));
+            break;
+        }
+        case OP_WORKER_REMOVED: {
+            int id = in.i32();
+            target.workers.erase(remove_if(target.workers.begin(), target.workers.end(),
+                [id](const unique_ptr<Worker>& w) { return w->id == id; }), target.workers.end());
+            break;
+        }
+        case OP_MARKET: {
+            uint32_t count = in.u32();
+            target.marketAnimals.clear();
+            for (uint32_t i = 0; i < count && in.good(); i++) {
+                auto animal = readAnimal(in);
+                if (!animal) return false;
+                target.marketAnimals.push_back(move(animal));
+            }
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+unique_ptr<Zoo> ZooJournal::recover(const string& basePath) {
+    unique_ptr<Zoo> restored;
+    uint64_t snapshotSequence = 0;
+    unique_ptr<Zoo> temporary;
+    uint64_t temporarySequence = 0;
+    bool hasSnapshot = readSnapshot(basePath + ".snapshot", restored, snapshotSequence);
+    if (readSnapshot(basePath + ".snapshot.tmp", temporary, temporarySequence) &&
+        (!hasSnapshot || temporarySequence > snapshotSequence)) {
+        restored = move(temporary);
+        snapshotSequence = temporarySequence;
+        hasSnapshot = true;
+    }
+    if (!hasSnapshot) return nullptr;
+
+    ifstream file(basePath + ".journal", ios::binary);
+    if (!file) return restored;
+    vector<uint8_t> bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+
+    // Кадры применяются по порядку до первой оборванной или поврежденной записи
+    size_t position = 0;
+    while (bytes.size() - position >= 8) {
+        ByteReader header(bytes.data() + position, 8);
+        uint32_t length = header.u32();
+        uint32_t checksum = header.u32();
+        if (bytes.size() - position - 8 < length) break;
+        const uint8_t* payload = bytes.data() + position + 8;
+        if (journalChecksum(payload, length) != checksum) break;
+        position += 8 + static_cast<size_t>(length);
+
+        ByteReader in(payload, length);
+        if (in.u8() != RECORD_FRAME) break;
+        uint64_t frameSequence = in.u64();
+        if (frameSequence <= snapshotSequence) continue;
+        if (!applyFrame(*restored, in)) break;
+    }
+    restored->updateMaps();
+    return restored;
+}
+
+// Пул потоков для пакетной обработки независимых задач (например, шагов разных зоопарков)
+
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount = thread::hardware_concurrency()) : stopping(false) {
+        threadCount = max<size_t>(1, threadCount);
+        for (size_t i = 0; i < threadCount; i++) {
+            threads.emplace_back([this]() { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            lock_guard<mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueReady.notify_all();
+        for (auto& worker : threads) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const { return threads.size(); }
+
+// Выполнение task(i) для i из [0, count) пакетами по batchSize индексов.
+// Вызывающий поток тоже участвует в работе, поэтому вложенные вызовы не блокируют пул.
+// Если task бросил исключение, оставшиеся пакеты пропускаются, а первое исключение
+// пробрасывается вызывающему после завершения всех пакетов
+
+    void parallelFor(size_t count, const function<void(size_t)>& task, size_t batchSize = 1) {
+        if (count == 0) return;
+        batchSize = max<size_t>(1, batchSize);
+
+        struct Batch {
+            function<void(size_t)> task;
+            size_t count;
+            size_t batchSize;
+            atomic<size_t> next{ 0 };
+            atomic<size_t> done{ 0 };
+            atomic<bool> failed{ false };
+            exception_ptr error;
+            mutex doneMutex;
+            condition_variable allDone;
+        };
+        auto batch = make_shared<Batch>();
+        batch->task = task;
+        batch->count = count;
+        batch->batchSize = batchSize;
+
+        auto run = [batch]() {
+            while (true) {
+                size_t begin = batch->next.fetch_add(batch->batchSize);
+                if (begin >= batch->count) return;
+                size_t end = min(batch->count, begin + batch->batchSize);
+                if (!batch->failed.load()) {
+                    try {
+                        for (size_t i = begin; i < end; i++) batch->task(i);
+                    }
+                    catch (...) {
+                        lock_guard<mutex> lock(batch->doneMutex);
+                        if (!batch->error) batch->error = current_exception();
+                        batch->failed = true;
+                    }
+                }
+                if (batch->done.fetch_add(end - begin) + (end - begin) == batch->count) {
+                    lock_guard<mutex> lock(batch->doneMutex);
+                    batch->allDone.notify_all();
+                }
+            }
+        };
+
+        size_t batches = (count + batchSize - 1) / batchSize;
+        size_t helpers = min(threads.size(), batches - 1);
+        if (helpers > 0) {
+            {
+                lock_guard<mutex> lock(queueMutex);
+                for (size_t i = 0; i < helpers; i++) jobs.push(run);
+            }
+            queueReady.notify_all();
+        }
+        run();
+
+        unique_lock<mutex> lock(batch->doneMutex);
+        batch->allDone.wait(lock, [&]() { return batch->done.load() == batch->count; });
+        if (batch->error) rethrow_exception(batch->error);
+    }
+
+private:
+    vector<thread> threads;
+    queue<function<void()>> jobs;
+    mutex queueMutex;
+    condition_variable queueReady;
+    bool stopping;
+
+    void workerLoop() {
+        while (true) {
+            function<void()> job;
+            {
+                unique_lock<mutex> lock(queueMutex);
+                queueReady.wait(lock, [this]() { return stopping || !jobs.empty(); });
+                if (stopping && jobs.empty()) return;
+                job = move(jobs.front());
+                jobs.pop();
+            }
+            job();
+        }
+    }
+};
+
+// Модель посетителей: каждый посетитель - агент со своим интересом, бюджетом и удовлетворенностью.
+// За день он осматривает несколько вольеров, выбирая их с вероятностью, пропорциональной
+// привлекательности, тратит деньги по мере удовлетворенности и устает.
+// Агенты обсчитываются блоками в виде структуры массивов (по 4 агента за инструкцию SSE2,
+// без SSE2 - обычным циклом с тем же результатом), блоки распределяются по пулу потоков
+
+struct VisitorSettings {
+    int visitorsPerPopularity = 2;
+    int maxVisitors = 4000000;
+    int stops = 8;
+    float fatigue = 0.85f;
+    float spendPerSatisfaction = 40.0f;
+    float minBudget = 200.0f;
+    float maxBudget = 3000.0f;
+    float happyThreshold = 60.0f;
+    float unhappyThreshold = 10.0f;
+    float walkCells = 60.0f;
+};
+
+class VisitorEngine {
+public:
+    static constexpr size_t blockSize = 4096;
+    static const int tableBits = 10;
+    static const uint32_t seedStep = 0x9E3779B9u;
+
+    explicit VisitorEngine(ThreadPool& threadPool, VisitorSettings visitorSettings = VisitorSettings())
+        : pool(threadPool), settings(visitorSettings) {
+    }
+
+    const VisitorSettings& config() const { return settings; }
+
+// День посетителей: attraction - привлекательность каждого вольера (0 - туда не заходят),
+// seed задает случайность дня, результат не зависит от числа потоков
+
+    VisitorDayResult simulateDay(const vector<float>& attraction, int popularity, uint32_t seed) const {
+        VisitorDayResult result;
+        result.visitors = static_cast<int>(min<long long>(
+            static_cast<long long>(max(popularity, 0)) * settings.visitorsPerPopularity, settings.maxVisitors));
+        if (result.visitors == 0) return result;
+
+        array<float, 1 << tableBits> table;
+        buildChoiceTable(attraction, table);
+
+        size_t visitorCount = static_cast<size_t>(result.visitors);
+        size_t blocks = (visitorCount + blockSize - 1) / blockSize;
+        vector<BlockTotals> totals(blocks);
+        pool.parallelFor(blocks, [&](size_t block) {
+            size_t count = min(blockSize, visitorCount - block * blockSize);
+            totals[block] = simulateBlock(table.data(), count, seed + static_cast<uint32_t>(block * blockSize) * seedStep);
+        }, max<size_t>(1, blocks / (pool.size() * 4)));
+
+        double spending = 0.0;
+        double satisfaction = 0.0;
+        for (const auto& block : totals) {
+            spending += block.spending;
+            satisfaction += block.satisfaction;
+        }
+        result.spending = llround(spending);
+        result.averageSatisfaction = satisfaction / visitorCount;
+        if (result.averageSatisfaction >= settings.happyThreshold) result.popularityChange = 1;
+        else if (result.averageSatisfaction < settings.unhappyThreshold) result.popularityChange = -1;
+        return result;
+    }
+
+private:
+    struct BlockTotals {
+        double spending = 0.0;
+        double satisfaction = 0.0;
+    };
+
+    // Состояние блока агентов (структура массивов), свое у каждого потока
+    struct VisitorBlock {
+        alignas(16) float interest[blockSize];
+        alignas(16) float budget[blockSize];
+        alignas(16) float satisfaction[blockSize];
+        alignas(16) uint32_t rng[blockSize];
+    };
+
+    ThreadPool& pool;
+    VisitorSettings settings;
+
+// Таблица выбора вольера: равномерное случайное число -> привлекательность выбранного вольера
+
+    static void buildChoiceTable(const vector<float>& attraction, array<float, 1 << tableBits>& table) {
+        double total = 0.0;
+        for (float value : attraction) total += max(value, 0.0f);
+        if (total <= 0.0) {
+            table.fill(0.0f);
             return;
         }
+        size_t enclosure = 0;
+        double cumulative = max(attraction[0], 0.0f);
+        for (size_t bucket = 0; bucket < table.size(); bucket++) {
+            double point = (bucket + 0.5) * total / table.size();
+            while (cumulative < point && enclosure + 1 < attraction.size()) {
+                enclosure++;
+                cumulative += max(attraction[enclosure], 0.0f);
+            }
+            table[bucket] = attraction[enclosure];
+        }
+    }
+
+    static uint32_t nextRandom(uint32_t state) {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+
+    static float unitFloat(uint32_t state) { return static_cast<float>(state >> 8) * (1.0f / 16777216.0f); }
+
+    BlockTotals simulateBlock(const float* table, size_t count, uint32_t seed) const {
+        thread_local unique_ptr<VisitorBlock> storage;
+        if (!storage) storage = make_unique<VisitorBlock>();
+        VisitorBlock& block = *storage;
+
+        // Число агентов дополняется до кратного 4 нулевыми агентами (они ничего не тратят)
+        size_t lanes = (count + 3) & ~static_cast<size_t>(3);
+#ifdef ZOOSIMS_SSE2
+        initSse2(block, lanes, seed);
+#else
+        initScalar(block, lanes, seed);
+#endif
+        for (size_t i = count; i < lanes; i++) {
+            block.interest[i] = 0.0f;
+            block.budget[i] = 0.0f;
+        }
+
+        // Траты и удовлетворенность копятся по 4 дорожкам в одном и том же порядке в обоих вариантах
+        alignas(16) float spent[4] = {};
+        alignas(16) float gained[4] = {};
+        for (int stop = 0; stop < settings.stops; stop++) {
+#ifdef ZOOSIMS_SSE2
+            stepSse2(block, table, lanes, spent, gained);
+#else
+            stepScalar(block, table, lanes, spent, gained);
+#endif
+        }
+
+        BlockTotals totals;
+        for (int lane = 0; lane < 4; lane++) {
+            totals.spending += spent[lane];
+            totals.satisfaction += gained[lane];
+        }
+        return totals;
+    }
+
+// Новые посетители блока: интерес 0.2-1, бюджет от minBudget до maxBudget
+
+    void initScalar(VisitorBlock& block, size_t lanes, uint32_t seed) const {
+        for (size_t i = 0; i < lanes; i++) {
+            uint32_t state = (seed + static_cast<uint32_t>(i) * seedStep) | 1u;
+            state = nextRandom(nextRandom(nextRandom(state)));
+            block.interest[i] = 0.2f + 0.8f * unitFloat(state);
+            state = nextRandom(state);
+            block.budget[i] = settings.minBudget + (settings.maxBudget - settings.minBudget) * unitFloat(state);
+            block.satisfaction[i] = 0.0f;
+            block.rng[i] = state;
+        }
+    }
+
+// Один осмотр вольера всеми агентами блока. Довольный посетитель тратит охотнее
+
+    void stepScalar(VisitorBlock& block, const float* table, size_t lanes, float* spent, float* gained) const {
+        for (size_t i = 0; i < lanes; i++) {
+            uint32_t state = nextRandom(block.rng[i]);
+            block.rng[i] = state;
+            float gain = block.interest[i] * table[state >> (32 - tableBits)];
+            float eagerness = 1.0f + block.satisfaction[i] * 0.01f;
+            float spend = min(block.budget[i], gain * settings.spendPerSatisfaction * eagerness);
+            block.satisfaction[i] += gain;
+            block.budget[i] -= spend;
+            block.interest[i] *= settings.fatigue;
+            spent[i & 3] += spend;
+            gained[i & 3] += gain;
+        }
+    }
+
+#ifdef ZOOSIMS_SSE2
+    static __m128i nextRandom(__m128i state) {
+        state = _mm_xor_si128(state, _mm_slli_epi32(state, 13));
+        state = _mm_xor_si128(state, _mm_srli_epi32(state, 17));
+        return _mm_xor_si128(state, _mm_slli_epi32(state, 5));
+    }
+
+    static __m128 unitFloat(__m128i state) {
+        return _mm_mul_ps(_mm_cvtepi32_ps(_mm_srli_epi32(state, 8)), _mm_set1_ps(1.0f / 16777216.0f));
+    }
+
+    void initSse2(VisitorBlock& block, size_t lanes, uint32_t seed) const {
+        const __m128i laneOffsets = _mm_setr_epi32(0, static_cast<int>(seedStep), static_cast<int>(2 * seedStep),
+            static_cast<int>(3 * seedStep));
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128 minBudget = _mm_set1_ps(settings.minBudget);
+        const __m128 budgetRange = _mm_set1_ps(settings.maxBudget - settings.minBudget);
+        for (size_t i = 0; i < lanes; i += 4) {
+            __m128i base = _mm_set1_epi32(static_cast<int>(seed + static_cast<uint32_t>(i) * seedStep));
+            __m128i state = _mm_or_si128(_mm_add_epi32(base, laneOffsets), one);
+            state = nextRandom(nextRandom(nextRandom(state)));
+            _mm_store_ps(block.interest + i,
+                _mm_add_ps(_mm_set1_ps(0.2f), _mm_mul_ps(_mm_set1_ps(0.8f), unitFloat(state))));
+            state = nextRandom(state);
+            _mm_store_ps(block.budget + i, _mm_add_ps(minBudget, _mm_mul_ps(budgetRange, unitFloat(state))));
+            _mm_store_ps(block.satisfaction + i, _mm_setzero_ps());
+            _mm_store_si128(reinterpret_cast<__m128i*>(block.rng + i), state);
+        }
+    }
+
+    void stepSse2(VisitorBlock& block, const float* table, size_t lanes, float* spent, float* gained) const {
+        const __m128 rate = _mm_set1_ps(settings.spendPerSatisfaction);
+        const __m128 fatigue = _mm_set1_ps(settings.fatigue);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 percent = _mm_set1_ps(0.01f);
+        __m128 spentTotal = _mm_load_ps(spent);
+        __m128 gainedTotal = _mm_load_ps(gained);
+        alignas(16) uint32_t index[4];
+        for (size_t i = 0; i < lanes; i += 4) {
+            __m128i state = nextRandom(_mm_load_si128(reinterpret_cast<const __m128i*>(block.rng + i)));
+            _mm_store_si128(reinterpret_cast<__m128i*>(block.rng + i), state);
+            _mm_store_si128(reinterpret_cast<__m128i*>(index), _mm_srli_epi32(state, 32 - tableBits));
+            __m128 attraction = _mm_setr_ps(table[index[0]], table[index[1]], table[index[2]], table[index[3]]);
+
+            __m128 interest = _mm_load_ps(block.interest + i);
+            __m128 budget = _mm_load_ps(block.budget + i);
+            __m128 satisfaction = _mm_load_ps(block.satisfaction + i);
+            __m128 gain = _mm_mul_ps(interest, attraction);
+            __m128 eagerness = _mm_add_ps(one, _mm_mul_ps(satisfaction, percent));
+            __m128 spend = _mm_min_ps(budget, _mm_mul_ps(_mm_mul_ps(gain, rate), eagerness));
+            _mm_store_ps(block.satisfaction + i, _mm_add_ps(satisfaction, gain));
+            _mm_store_ps(block.budget + i, _mm_sub_ps(budget, spend));
+            _mm_store_ps(block.interest + i, _mm_mul_ps(interest, fatigue));
+            spentTotal = _mm_add_ps(spentTotal, spend);
+            gainedTotal = _mm_add_ps(gainedTotal, gain);
+        }
+        _mm_store_ps(spent, spentTotal);
+        _mm_store_ps(gained, gainedTotal);
+    }
+#endif
+};
+
+VisitorDayResult Zoo::simulateVisitors() {
+    ensureEntities();
+    const SpeciesCatalog& catalog = SpeciesCatalog::instance();
+    visitorAttraction.assign(enclosures.size(), 0.0f);
+    for (size_t i = 0; i < enclosures.size(); i++) {
+        for (auto animal : enclosures[i]->containedAnimals) {
+            if (!animal->isAlive) continue;
+            visitorAttraction[i] += catalog.at(animal->speciesId).attractiveness * animal->trueHappiness / 100.0f;
+        }
+        // До дальних вольеров доходит меньше посетителей (учитывается только путь от входа,
+        // переходы посетителей между вольерами по карте не моделируются)
+        float walk = visitorEngine->config().walkCells;
+        visitorAttraction[i] *= walk / (walk + layout->distanceFromEntrance(i));
+    }
+    VisitorDayResult result = visitorEngine->simulateDay(visitorAttraction, popularity, static_cast<uint32_t>(simRand()));
+    simOut() << L"Посетители потратили " << result.spending << L" руб., средняя удовлетворенность "
+        << static_cast<int>(result.averageSatisfaction) << L"." << endl;
+    return result;
+}
+
+// Очередь с несколькими писателями и одним читателем без блокировок (схема Вьюкова):
+// писатель одним атомарным обменом цепляет узел в голову, читатель снимает узлы с хвоста
+
+template <typename T>
+class LockFreeQueue {
+public:
+    LockFreeQueue() : head(&stub), tail(&stub) {
+        stub.next.store(nullptr, memory_order_relaxed);
+    }
+
+    ~LockFreeQueue() {
+        T item;
+        while (pop(item)) {}
+        if (tail != &stub) delete tail;
+    }
+
+    LockFreeQueue(const LockFreeQueue&) = delete;
+    LockFreeQueue& operator=(const LockFreeQueue&) = delete;
+
+// Добавление элемента (из любого потока)
+
+    void push(T item) {
+        Node* node = new Node;
+        node->item = move(item);
+        node->next.store(nullptr, memory_order_relaxed);
+        Node* previous = head.exchange(node, memory_order_acq_rel);
+        previous->next.store(node, memory_order_release);
+    }
+
+// Извлечение элемента (только из потока-читателя)
+
+    bool pop(T& item) {
+        Node* first = tail;
+        Node* next = first->next.load(memory_order_acquire);
+        if (!next) return false;
+        item = move(next->item);
+        tail = next;
+        if (first != &stub) delete first;
+        return true;
+    }
+
+private:
+    struct Node {
+        atomic<Node*> next;
+        T item;
+    };
+
+    Node stub;
+    atomic<Node*> head;
+    Node* tail;
+};
+
+// Команды игрока для потока симуляции режима реального времени
+
+using CommandQueue = LockFreeQueue<ZooCommand>;
+
+// Биржа обмена животными между зоопарками хоста. Зоопарки выставляют заявки на продажу
+// (животное уходит на биржу) и на покупку по виду, климату и предельной цене (деньги
+// резервируются) из своих потоков без общей блокировки: заявки попадают в очередь без
+// блокировок. Сведение идет раз в день в потоке хоста: заявки из очереди раскладываются
+// по стаканам "вид + климат", и сводятся только стаканы, куда пришли новые заявки.
+// Сделка идет по цене продавца, остаток резерва возвращается покупателю
+
+class AnimalExchange {
+public:
+// Итог по заявке для зоопарка: деньги (выручка или возврат резерва) и/или животное
+
+    struct Settlement {
+        int zooId = 0;
+        uint64_t orderId = 0;
+        int money = 0;
+        unique_ptr<Animal> animal;
+    };
+
+    AnimalExchange() : nextOrderId(1) {}
+
+    static int climateIndex(const wstring& climate) {
+        auto it = find(climates.begin(), climates.end(), climate);
+        return it != climates.end() ? static_cast<int>(it - climates.begin()) : -1;
+    }
+
+// Выставление заявок (из любого потока). Возвращают номер заявки
+
+    uint64_t submitSell(int zooId, unique_ptr<Animal> animal, int price) {
+        Order order;
+        order.kind = ORDER_SELL;
+        order.id = nextOrderId.fetch_add(1, memory_order_relaxed);
+        order.zooId = zooId;
+        order.key = bookKey(animal->speciesId, climateIndex(animal->climate));
+        order.price = price;
+        order.animal = move(animal);
+        uint64_t id = order.id;
+        inbox.push(move(order));
+        return id;
+    }
+
+    uint64_t submitBuy(int zooId, int speciesId, int climate, int maxPrice) {
+        Order order;
+        order.kind = ORDER_BUY;
+        order.id = nextOrderId.fetch_add(1, memory_order_relaxed);
+        order.zooId = zooId;
+        order.key = bookKey(speciesId, climate);
+        order.price = maxPrice;
+        uint64_t id = order.id;
+        inbox.push(move(order));
+        return id;
+    }
+
+    void cancel(int zooId, uint64_t orderId) {
+        Order order;
+        order.kind = ORDER_CANCEL;
+        order.id = orderId;
+        order.zooId = zooId;
+        inbox.push(move(order));
+    }
+
+// Сведение заявок. Очередь заявок разбирает один поток за раз, поэтому одновременные вызовы
+// выполняются по очереди. Итоги сделок и отмен добавляются в settled, возвращается число сделок
+
+    size_t match(vector<Settlement>& settled) {
+        lock_guard<mutex> lock(matchMutex);
+        vector<uint32_t> touched;
+        Order order;
+        while (inbox.pop(order)) {
+            if (order.kind == ORDER_CANCEL) {
+                auto it = open.find(order.id);
+                if (it == open.end() || it->second.zooId != order.zooId) continue;
+                settled.push_back(refund(it->second));
+                open.erase(it);
+                continue;
+            }
+            Book& book = books[order.key];
+            if (!book.touched) {
+                book.touched = true;
+                touched.push_back(order.key);
+            }
+            Quote quote{ order.price, order.id };
+            if (order.kind == ORDER_SELL) book.asks.push(quote);
+            else book.bids.push(quote);
+            uint64_t id = order.id;
+            open.emplace(id, move(order));
+        }
+
+        size_t trades = 0;
+        for (uint32_t key : touched) {
+            Book& book = books[key];
+            book.touched = false;
+            while (true) {
+                dropClosed(book.asks);
+                dropClosed(book.bids);
+                if (book.asks.empty() || book.bids.empty() || book.asks.top().price > book.bids.top().price) break;
+                auto ask = open.find(book.asks.top().orderId);
+                auto bid = open.find(book.bids.top().orderId);
+                book.asks.pop();
+                book.bids.pop();
+
+                Settlement seller;
+                seller.zooId = ask->second.zooId;
+                seller.orderId = ask->first;
+                seller.money = ask->second.price;
+                Settlement buyer;
+                buyer.zooId = bid->second.zooId;
+                buyer.orderId = bid->first;
+                buyer.money = bid->second.price - ask->second.price;
+                buyer.animal = move(ask->second.animal);
+                buyer.animal->price = ask->second.price;
+                settled.push_back(move(seller));
+                settled.push_back(move(buyer));
+                open.erase(ask);
+                open.erase(bid);
+                trades++;
+            }
+            if (book.asks.empty() && book.bids.empty()) books.erase(key);
+        }
+        return trades;
+    }
+
+    size_t openOrders() const {
+        lock_guard<mutex> lock(matchMutex);
+        return open.size();
+    }
+
+private:
+    enum OrderKind : uint8_t { ORDER_SELL, ORDER_BUY, ORDER_CANCEL };
+
+    struct Order {
+        OrderKind kind = ORDER_SELL;
+        uint64_t id = 0;
+        int zooId = 0;
+        uint32_t key = 0;
+        int price = 0;
+        unique_ptr<Animal> animal;
+    };
+
+    struct Quote {
+        int price;
+        uint64_t orderId;
+    };
+
+    // Лучшая продажа - самая дешевая, лучшая покупка - самая дорогая; при равной цене раньше выставленная
+    struct AskOrder {
+        bool operator()(const Quote& a, const Quote& b) const {
+            return a.price != b.price ? a.price > b.price : a.orderId > b.orderId;
+        }
+    };
+
+    struct BidOrder {
+        bool operator()(const Quote& a, const Quote& b) const {
+            return a.price != b.price ? a.price < b.price : a.orderId > b.orderId;
+        }
+    };
+
+    struct Book {
+        priority_queue<Quote, vector<Quote>, AskOrder> asks;
+        priority_queue<Quote, vector<Quote>, BidOrder> bids;
+        bool touched = false;
+    };
+
+    LockFreeQueue<Order> inbox;
+    atomic<uint64_t> nextOrderId;
+    mutable mutex matchMutex;
+    unordered_map<uint64_t, Order> open;
+    unordered_map<uint32_t, Book> books;
+
+    static uint32_t bookKey(int speciesId, int climate) {
+        return static_cast<uint32_t>(speciesId) * static_cast<uint32_t>(climates.size() + 1) + static_cast<uint32_t>(climate + 1);
+    }
+
+// Отмененные заявки остаются в куче и выбрасываются, когда оказываются на вершине
+
+    template <typename Heap>
+    void dropClosed(Heap& heap) {
+        while (!heap.empty() && !open.count(heap.top().orderId)) heap.pop();
+    }
+
+    static Settlement refund(Order& order) {
+        Settlement result;
+        result.zooId = order.zooId;
+        result.orderId = order.id;
+        if (order.kind == ORDER_SELL) result.animal = move(order.animal);
+        else result.money = order.price;
+        return result;
+    }
+};
+
+// Параметры синтетического сценария для нагрузочных проверок и замеров
+
+struct ScenarioSpec {
+    // Доли видов: (ID вида в каталоге, вес). Пустой список - все виды поровну
+    vector<pair<int, int>> speciesMix;
+    array<int, ENCLOSURE_PETTING_ZOO + 1> enclosureCount{};
+    array<int, WORKER_GUIDE + 1> workerCount{};
+    // Заполненность вольеров (0-1) и доля больных животных
+    double occupancy = 0.8;
+    double sickRatio = 0.05;
+    long long money = 500000;
+    // На сколько дней хватит корма при начальной численности
+    int foodDays = 30;
+    int victoryDays = 100;
+    unsigned seed = 1;
+};
+
+// Генератор сценария: строит зоопарк с миллионами согласованных сущностей за один проход
+// и загружает их через Zoo::bulkInsert. Вольер получает климат, в котором живет хотя бы
+// один вид смеси подходящего типа, и заселяется этими видами по их весам. Животные
+// копируются из заготовок (вид, климат, пол), поэтому поиск вида в каталоге и подбор имени
+// выполняются один раз на заготовку, а не на каждое животное
+
+class ScenarioGenerator {
+public:
+    explicit ScenarioGenerator(const ScenarioSpec& scenario) : spec(scenario), random(scenario.seed) {}
+
+    unique_ptr<Zoo> generate() {
+        const SpeciesCatalog& catalog = SpeciesCatalog::instance();
+        buildCandidates(catalog);
+
+        auto zoo = make_unique<Zoo>(L"Сценарий " + to_wstring(spec.seed), L"Генератор", spec.victoryDays);
+        EntityBatch batch;
+        size_t enclosureTotal = 0;
+        size_t animalEstimate = 0;
+        for (const auto& info : catalog.enclosureTypes()) {
+            enclosureTotal += max(0, spec.enclosureCount[info.type]);
+            animalEstimate += static_cast<size_t>(max(0, spec.enclosureCount[info.type])) * fillOf(info.capacity);
+        }
+        batch.enclosures.reserve(enclosureTotal);
+        batch.animals.reserve(animalEstimate);
+
+        for (const auto& info : catalog.enclosureTypes()) {
+            for (int i = 0; i < spec.enclosureCount[info.type]; i++) {
+                int climate = pickClimate(animalTypeOf(info.type));
+                batch.enclosures.push_back(make_unique<Enclosure>(0, info.capacity, info.type, climates[climate], info.price / 10));
+                Enclosure& enclosure = *batch.enclosures.back();
+                const Candidates& residents = candidates[candidateIndex(animalTypeOf(info.type), climate)];
+                if (residents.total == 0) continue;
+                for (int slot = fillOf(info.capacity); slot > 0; slot--) {
+                    batch.animals.push_back(makeAnimal(residents, climate));
+                    enclosure.attach(batch.animals.back().get());
+                }
+            }
+        }
+
+        for (int type = WORKER_VET; type <= WORKER_GUIDE; type++) {
+            const wstring& title = catalog.worker(static_cast<WorkerType>(type)).name;
+            for (int i = 0; i < spec.workerCount[type]; i++) {
+                batch.workers.push_back(make_unique<Worker>(0, title + L" " + to_wstring(i + 1), static_cast<WorkerType>(type)));
+            }
+        }
+
+        zoo->bulkInsert(move(batch));
+        zoo->ledger.reset(spec.money);
+        array<int, FOOD_TYPE_COUNT> need = zoo->dailyFoodNeed();
+        for (int food = 0; food < FOOD_TYPE_COUNT; food++) {
+            zoo->foodStock[food] = static_cast<int>(min<long long>(numeric_limits<int>::max(),
+                max(50LL, static_cast<long long>(need[food]) * max(0, spec.foodDays))));
+        }
+        return zoo;
+    }
+
+private:
+    static const int animalTypeCount = 4;
+
+    // Виды одного типа животных, живущие в одном климате, с накопленными весами
+    struct Candidates {
+        vector<int> speciesIds;
+        vector<int> cumulative;
+        int total = 0;
+    };
+
+    ScenarioSpec spec;
+    mt19937 random;
+    vector<Candidates> candidates;
+    unordered_map<int, unique_ptr<Animal>> prototypes;
+
+    static AnimalType animalTypeOf(EnclosureType type) {
+        switch (type) {
+        case ENCLOSURE_AQUARIUM: return AnimalType::AQUATIC;
+        case ENCLOSURE_BIRD_CAGE: return AnimalType::BIRD;
+        case ENCLOSURE_REPTILE_HOUSE: return AnimalType::REPTILE;
+        default: return AnimalType::LAND;
+        }
+    }
+
+    static size_t candidateIndex(AnimalType type, int climate) {
+        return static_cast<size_t>(climate) * animalTypeCount + static_cast<size_t>(type);
+    }
+
+    int fillOf(int capacity) const {
+        double share = max(0.0, min(1.0, spec.occupancy));
+        return static_cast<int>(lround(capacity * share));
+    }
+
+    void buildCandidates(const SpeciesCatalog& catalog) {
+        vector<int> weights(catalog.size(), spec.speciesMix.empty() ? 1 : 0);
+        for (const auto& entry : spec.speciesMix) {
+            if (entry.first >= 0 && entry.first < static_cast<int>(weights.size())) weights[entry.first] += max(0, entry.second);
+        }
+        candidates.assign(climates.size() * animalTypeCount, Candidates());
+        for (size_t id = 0; id < catalog.size(); id++) {
+            if (weights[id] == 0) continue;
+            const SpeciesInfo& info = catalog.at(static_cast<int>(id));
+            for (int climate = 0; climate < static_cast<int>(climates.size()); climate++) {
+                if (!info.livesIn(climate)) continue;
+                Candidates& entry = candidates[candidateIndex(info.type, climate)];
+                entry.total += weights[id];
+                entry.speciesIds.push_back(static_cast<int>(id));
+                entry.cumulative.push_back(entry.total);
+            }
+        }
+    }
+
+// Климат вольера: с вероятностью по суммарному весу видов нужного типа, живущих в нем
+
+    int pickClimate(AnimalType type) {
+        int total = 0;
+        for (int climate = 0; climate < static_cast<int>(climates.size()); climate++) {
+            total += candidates[candidateIndex(type, climate)].total;
+        }
+        if (total == 0) return static_cast<int>(random() % climates.size());
+        int roll = static_cast<int>(random() % static_cast<unsigned>(total));
+        for (int climate = 0; climate < static_cast<int>(climates.size()); climate++) {
+            roll -= candidates[candidateIndex(type, climate)].total;
+            if (roll < 0) return climate;
+        }
+        return 0;
+    }
+
+    unique_ptr<Animal> makeAnimal(const Candidates& residents, int climate) {
+        int roll = static_cast<int>(random() % static_cast<unsigned>(residents.total));
+        size_t pick = upper_bound(residents.cumulative.begin(), residents.cumulative.end(), roll) - residents.cumulative.begin();
+        int speciesId = residents.speciesIds[pick];
+        wchar_t gender = (random() & 1) ? 'M' : 'F';
+
+        unique_ptr<Animal>& prototype = prototypes[(speciesId * static_cast<int>(climates.size()) + climate) * 2 + (gender == 'M')];
+        if (!prototype) {
+            const SpeciesInfo& info = SpeciesCatalog::instance().at(speciesId);
+            prototype = make_unique<Animal>(0, wstring(), info.name, 0, 1, climates[climate], info.isPredator, 5000, gender);
+        }
+
+        auto animal = make_unique<Animal>(*prototype);
+        const SpeciesInfo& info = SpeciesCatalog::instance().at(speciesId);
+        animal->genome = Genome::random(random());
+        animal->maxAge = max(1, Genome::scale(animal->genome, GENE_LIFESPAN,
+            info.maxAge != -1 ? info.maxAge : 10 + static_cast<int>(random() % 10)));
+        animal->age = static_cast<int>(random() % static_cast<unsigned>(max(1, animal->maxAge)));
+        animal->weight = 1 + static_cast<int>(random() % 200);
+        animal->price = 5000 + static_cast<int>(random() % 45000);
+        animal->trueHappiness = 40 + static_cast<int>(random() % 61);
+        animal->displayedHappiness = animal->trueHappiness;
+        if (random() < spec.sickRatio * 4294967296.0) {
+            animal->health = AnimalHealth::SICK;
+            animal->hasDisease = true;
+            animal->daysSick = 1 + static_cast<int>(random() % 3);
+        }
+        return animal;
+    }
+};
+
+// Проверка восстановления журнала после падения (проверочный зоопарк строит ScenarioGenerator).
+// В каждой точке падения журнал прерывается после трех дней, и recover() должен вернуть
+// состояние последней целиком записанной записи: нового снимка или кадра перед оборванным.
+// Дни после падения в файлы не попадают
+
+bool ZooJournal::verifyCrashRecovery(const string& basePath) {
+    const string files[] = { basePath + ".snapshot", basePath + ".snapshot.tmp", basePath + ".journal" };
+    auto removeFiles = [&]() {
+        for (const auto& path : files) std::remove(path.c_str());
+    };
+    SimOutputScope quiet(quietStream());
+    SimRandomScope random(1);
+    bool passed = true;
+    for (CrashPoint point : { CRASH_SNAPSHOT_WRITTEN, CRASH_SNAPSHOT_REMOVED, CRASH_SNAPSHOT_RENAMED,
+        CRASH_JOURNAL_TRUNCATED, CRASH_FRAME_TORN }) {
+        removeFiles();
+        ScenarioSpec spec;
+        spec.enclosureCount.fill(2);
+        spec.workerCount.fill(1);
+        spec.seed = point;
+        unique_ptr<Zoo> zoo = ScenarioGenerator(spec).generate();
+
+        ByteWriter expected;
+        {
+            ZooJournal journal(basePath);
+            journal.attach(*zoo);
+            for (int day = 0; day < 3; day++) zoo->nextDay();
+            journal.flush();
+            journal.crashAt = point;
+            if (point != CRASH_FRAME_TORN) journal.checkpoint(*zoo);
+            writeState(expected, *zoo);
+            for (int day = 0; day < 2; day++) zoo->nextDay();
+            journal.detach();
+        }
+
+        unique_ptr<Zoo> restored = recover(basePath);
+        ByteWriter actual;
+        if (restored) writeState(actual, *restored);
+        passed = passed && restored && actual.bytes == expected.bytes;
+    }
+    removeFiles();
+    return passed;
+}
+
+// Класс ZooHost: держит множество независимых зоопарков в одном процессе.
+// Каталог видов общий, зоопарки обсчитываются пакетами на пуле потоков,
+// а сообщения симуляции фоновых зоопарков не выводятся в консоль
+
+class ZooHost {
+public:
+    explicit ZooHost(size_t threadCount = thread::hardware_concurrency())
+        : pool(threadCount), nextZooId(1) {
+        SpeciesCatalog::instance();
+    }
+
+// Создание нового зоопарка, возвращает его ID
+
+    int createZoo(const wstring& zooName, const wstring& directorName, int victoryDays) {
+        auto hosted = make_shared<HostedZoo>();
+        {
+            SimOutputScope quiet(quietStream());
+            hosted->zoo = make_unique<Zoo>(zooName, directorName, victoryDays);
+            hosted->zoo->trimMemory();
+        }
+        lock_guard<mutex> lock(registryMutex);
+        int zooId = nextZooId++;
+        zoos[zooId] = move(hosted);
+        return zooId;
+    }
+
+    bool destroyZoo(int zooId) {
+        lock_guard<mutex> lock(registryMutex);
+        return zoos.erase(zooId) > 0;
+    }
+
+    size_t zooCount() const {
+        lock_guard<mutex> lock(registryMutex);
+        return zoos.size();
+    }
+
+// Выполнение команды игрока в конкретном зоопарке
+
+    bool command(int zooId, const ZooCommand& command) {
+        shared_ptr<HostedZoo> hosted = find(zooId);
+        if (!hosted) return false;
+        lock_guard<mutex> lock(hosted->lock);
+        SimOutputScope quiet(quietStream());
+        return hosted->zoo->execute(command);
+    }
+
+// Продвижение одного зоопарка на несколько дней
+
+    bool step(int zooId, int days = 1) {
+        shared_ptr<HostedZoo> hosted = find(zooId);
+        if (!hosted) return false;
+        lock_guard<mutex> lock(hosted->lock);
+        SimOutputScope quiet(quietStream());
+        for (int i = 0; i < days && !hosted->zoo->isGameOver(); i++) {
+            hosted->zoo->nextDay();
+        }
+        return !hosted->zoo->isGameOver();
+    }
+
+// Продвижение всех зоопарков: зоопарки делятся на пакеты и обсчитываются на пуле потоков
+
+    void stepAll(int days = 1, size_t batchSize = 64) {
+        for (int day = 0; day < days; day++) {
+            settleExchange();
+            vector<shared_ptr<HostedZoo>> snapshot = allZoos();
+            pool.parallelFor(snapshot.size(), [&](size_t i) {
+                HostedZoo* hosted = snapshot[i].get();
+                lock_guard<mutex> lock(hosted->lock);
+                SimOutputScope quiet(quietStream());
+                if (!hosted->zoo->isGameOver()) hosted->zoo->nextDay();
+            }, batchSize);
+        }
+    }
+
+// Заявка на продажу: животное сразу уходит из зоопарка на биржу. 0, если животного нет
+
+    uint64_t postSellOrder(int zooId, int animalId, int price) {
+        shared_ptr<HostedZoo> hosted = find(zooId);
+        if (!hosted || price <= 0) return 0;
+        unique_ptr<Animal> animal;
+        {
+            lock_guard<mutex> lock(hosted->lock);
+            SimOutputScope quiet(quietStream());
+            animal = hosted->zoo->releaseAnimal(animalId);
+        }
+        if (!animal) return 0;
+        return exchange.submitSell(zooId, move(animal), price);
+    }
+
+// Заявка на покупку вида в заданном климате: maxPrice резервируется до сделки или отмены
+
+    uint64_t postBuyOrder(int zooId, const wstring& species, const wstring& climate, int maxPrice) {
+        const SpeciesInfo* info = SpeciesCatalog::instance().find(species);
+        if (!info || !info->livesIn(AnimalExchange::climateIndex(climate))) return 0;
+        shared_ptr<HostedZoo> hosted = find(zooId);
+        if (!hosted || maxPrice <= 0) return 0;
+        {
+            lock_guard<mutex> lock(hosted->lock);
+            if (!hosted->zoo->reserveMoney(maxPrice)) return 0;
+        }
+        return exchange.submitBuy(zooId, info->id, AnimalExchange::climateIndex(climate), maxPrice);
+    }
+
+// Отмена заявки: животное или резерв вернутся при следующем сведении
+
+    void cancelOrder(int zooId, uint64_t orderId) { exchange.cancel(zooId, orderId); }
+
+// Сведение заявок биржи и доставка итогов в зоопарки (stepAll делает это в начале каждого дня).
+// Можно вызывать из любого потока: биржа сводит заявки под своей блокировкой.
+// Итоги зоопарков, удаленных с хоста, пропадают. Возвращает число сделок
+
+    size_t settleExchange() {
+        vector<AnimalExchange::Settlement> settled;
+        size_t trades = exchange.match(settled);
+        if (settled.empty()) return trades;
+
+        sort(settled.begin(), settled.end(), [](const AnimalExchange::Settlement& a, const AnimalExchange::Settlement& b) {
+            return a.zooId != b.zooId ? a.zooId < b.zooId : a.orderId < b.orderId;
+        });
+        vector<size_t> groupStart;
+        for (size_t i = 0; i < settled.size(); i++) {
+            if (i == 0 || settled[i].zooId != settled[i - 1].zooId) groupStart.push_back(i);
+        }
+        groupStart.push_back(settled.size());
+        pool.parallelFor(groupStart.size() - 1, [&](size_t group) {
+            shared_ptr<HostedZoo> hosted = find(settled[groupStart[group]].zooId);
+            if (!hosted) return;
+            lock_guard<mutex> lock(hosted->lock);
+            SimOutputScope quiet(quietStream());
+            for (size_t i = groupStart[group]; i < groupStart[group + 1]; i++) {
+                hosted->zoo->receiveExchange(settled[i].money, move(settled[i].animal));
+            }
+        }, 16);
+        return trades;
+    }
+
+    size_t openExchangeOrders() const { return exchange.openOrders(); }
+
+// Доступ к зоопарку под его блокировкой
+
+    bool withZoo(int zooId, const function<void(Zoo&)>& action) {
+        shared_ptr<HostedZoo> hosted = find(zooId);
+        if (!hosted) return false;
+        lock_guard<mutex> lock(hosted->lock);
+        SimOutputScope quiet(quietStream());
+        action(*hosted->zoo);
+        return true;
+    }
+
+// Сжатие контейнеров у всех зоопарков (например, после пакетного шага)
+
+    void trimIdleZoos() {
+        vector<shared_ptr<HostedZoo>> snapshot = allZoos();
+        pool.parallelFor(snapshot.size(), [&](size_t i) {
+            lock_guard<mutex> lock(snapshot[i]->lock);
+            snapshot[i]->zoo->trimMemory();
+        }, 256);
+    }
+
+// Перевод всех зоопарков в компактный вид до следующего шага или команды
+
+    void hibernateIdleZoos() {
+        vector<shared_ptr<HostedZoo>> snapshot = allZoos();
+        pool.parallelFor(snapshot.size(), [&](size_t i) {
+            lock_guard<mutex> lock(snapshot[i]->lock);
+            snapshot[i]->zoo->hibernate();
+        }, 64);
+    }
+
+// Средний объем памяти на один зоопарк в байтах
+
+    size_t memoryPerZoo() const {
+        vector<shared_ptr<HostedZoo>> snapshot = allZoos();
+        if (snapshot.empty()) return 0;
+        size_t total = 0;
+        for (const auto& hosted : snapshot) {
+            lock_guard<mutex> lock(hosted->lock);
+            total += sizeof(HostedZoo) + hosted->zoo->memoryUsage();
+        }
+        return total / snapshot.size();
+    }
+
+private:
+    struct HostedZoo {
+        unique_ptr<Zoo> zoo;
+        mutex lock;
+    };
+
+    ThreadPool pool;
+    AnimalExchange exchange;
+    mutable mutex registryMutex;
+    unordered_map<int, shared_ptr<HostedZoo>> zoos;
+    int nextZooId;
+
+    shared_ptr<HostedZoo> find(int zooId) {
+        lock_guard<mutex> lock(registryMutex);
+        auto it = zoos.find(zooId);
+        return it != zoos.end() ? it->second : nullptr;
+    }
+
+    vector<shared_ptr<HostedZoo>> allZoos() const {
+        lock_guard<mutex> lock(registryMutex);
+        vector<shared_ptr<HostedZoo>> result;
+        result.reserve(zoos.size());
+        for (const auto& entry : zoos) result.push_back(entry.second);
+        return result;
+    }
+};
+
+// Настройки советника: горизонт моделирования, число прогонов на действие и бюджет времени.
+// Значения по умолчанию подобраны так, чтобы в зоопарке на 1000 животных все 16 действий
+// получили по 3 прогона за 100 мс даже на одном ядре (около 60 мс)
+
+struct AdvisorSettings {
+    int horizonDays = 5;
+    int rolloutsPerAction = 3;
+    int timeBudgetMs = 100;
+    size_t maxCandidates = 16;
+};
+
+// Возможное действие игрока (hasAction == false означает "ничего не делать")
+
+struct AdvisorCandidate {
+    bool hasAction = false;
+    ZooCommand command{ ZooCommandType::NEXT_DAY };
+    wstring description;
+};
 
-        Enclosure* parentsEnclosure = nullptr;
-        for (auto& enclosure : enclosures) {
-            bool found1 = false, found2 = false;
-            for (auto animal : enclosure->containedAnimals) {
-                if (animal->id == id1) found1 = true;
-                if (animal->id == id2) found2 = true;
-            }
-            if (found1 && found2) {
-                parentsEnclosure = enclosure.get();
-                break;
+// Оценка одного действия: средний результат и число завершенных прогонов
+
+struct AdvisorEstimate {
+    AdvisorCandidate action;
+    double meanScore = 0;
+    int samples = 0;
+};
+
+struct AdvisorRecommendation {
+    AdvisorCandidate action;
+    double expectedScore = 0;
+    double idleScore = 0;
+    int candidatesEvaluated = 0;
+    int rollouts = 0;
+    int minSamples = 0;
+    bool timedOut = false;
+    vector<AdvisorEstimate> estimates;
+};
+
+// Класс ZooAdvisor: подбирает лучшее действие поиском Монте-Карло.
+// Для каждого действия создаются ветки зоопарка (fork), в них действие выполняется,
+// затем ветка моделируется horizonDays дней. Прогоны идут параллельно на пуле потоков
+// и прекращаются по истечении бюджета времени. Прогон номер k у всех действий идет на одной
+// и той же последовательности случайных чисел (общие случайные числа), поэтому разница
+// оценок отражает само действие, а не случайный шум; генератор игры при этом не сдвигается
+
+class ZooAdvisor {
+public:
+    explicit ZooAdvisor(ThreadPool& pool, AdvisorSettings settings = AdvisorSettings())
+        : pool(pool), settings(settings) {
+    }
+
+    AdvisorRecommendation recommend(Zoo& zoo) {
+        zoo.wake();
+        auto deadline = chrono::steady_clock::now() + chrono::milliseconds(settings.timeBudgetMs);
+        vector<AdvisorCandidate> candidates = candidateActions(zoo);
+
+        struct Outcome {
+            double scoreSum = 0;
+            atomic<int> completed{ 0 };
+            mutex lock;
+        };
+        vector<Outcome> outcomes(candidates.size());
+        atomic<bool> timedOut{ false };
+        mt19937 peek = simRandomEngine();
+        unsigned seedBase = peek();
+
+        // Прогоны чередуются по действиям, чтобы при нехватке времени каждое получило оценку
+        size_t rollouts = candidates.size() * static_cast<size_t>(max(1, settings.rolloutsPerAction));
+        {
+            unique_ptr<Zoo> root = zoo.fork();
+            pool.parallelFor(rollouts, [&](size_t task) {
+                if (chrono::steady_clock::now() >= deadline) {
+                    timedOut = true;
+                    return;
+                }
+                size_t index = task % candidates.size();
+                unsigned seed = seedBase + static_cast<unsigned>(task / candidates.size()) * 0x9E3779B9u;
+                double score = 0;
+                if (!simulate(*root, candidates[index], seed, deadline, score)) {
+                    timedOut = true;
+                    return;
+                }
+                lock_guard<mutex> lock(outcomes[index].lock);
+                outcomes[index].scoreSum += score;
+                outcomes[index].completed++;
+            });
+        }
+        zoo.ensureEntities();
+
+        AdvisorRecommendation recommendation;
+        recommendation.timedOut = timedOut;
+        recommendation.minSamples = candidates.empty() ? 0 : numeric_limits<int>::max();
+        bool found = false;
+        for (size_t i = 0; i < candidates.size(); i++) {
+            int completed = outcomes[i].completed;
+            recommendation.minSamples = min(recommendation.minSamples, completed);
+            recommendation.estimates.push_back({ candidates[i], completed ? outcomes[i].scoreSum / completed : 0.0, completed });
+            if (completed == 0) continue;
+            double mean = outcomes[i].scoreSum / completed;
+            recommendation.candidatesEvaluated++;
+            recommendation.rollouts += completed;
+            if (!candidates[i].hasAction) recommendation.idleScore = mean;
+            if (!found || mean > recommendation.expectedScore) {
+                recommendation.action = candidates[i];
+                recommendation.expectedScore = mean;
+                found = true;
             }
         }
+        if (!found) recommendation.action = candidates.front();
+        return recommendation;
+    }
 
-        if (!parentsEnclosure) {
-            wcout << L"Животные должны быть в одном вольере для размножения!" << endl;
-            return;
-        }
+// Оценка состояния зоопарка: деньги, стоимость животных, запасы и популярность.
+// Поражение (банкротство или голод) оценивается очень низко
 
-        if (parentsEnclosure->containedAnimals.size() >= static_cast<size_t>(parentsEnclosure->capacity)) {
-            wcout << L"В вольере нет места для потомства!" << endl;
-            return;
+    static double score(const Zoo& zoo) {
+        if (zoo.isGameOver() && zoo.days < zoo.victoryDays) return -1e12 + zoo.days;
+        double value = static_cast<double>(zoo.ledger.balance()) + zoo.totalFood() * 80.0 + zoo.popularity * 2000.0;
+        for (const auto& animal : zoo.animalList()) {
+            if (animal->getIsAlive()) value += animal->price * 0.7;
         }
+        return value;
+    }
 
-        auto offspring = *animal1 + *animal2;
-        if (offspring.empty()) {
-            wcout << L"Размножение не удалось!" << endl;
-            return;
+private:
+    ThreadPool& pool;
+    AdvisorSettings settings;
+
+    bool simulate(Zoo& root, const AdvisorCandidate& candidate, unsigned seed, chrono::steady_clock::time_point deadline,
+        double& score) {
+        SimOutputScope quiet(quietStream());
+        SimRandomScope random(seed);
+        unique_ptr<Zoo> branch = root.fork();
+        if (candidate.hasAction) branch->execute(candidate.command);
+        for (int day = 0; day < settings.horizonDays && !branch->isGameOver(); day++) {
+            if (chrono::steady_clock::now() >= deadline) return false;
+            branch->nextDay();
         }
+        score = ZooAdvisor::score(*branch);
+        return true;
+    }
 
-        for (auto& baby : offspring) {
-            baby->id = nextAnimalId++;
-            animals.push_back(move(baby));
-            if (!parentsEnclosure->addAnimal(animals.back().get())) {
-                wcout << L"Не удалось добавить потомка в вольер!" << endl;
+// Перечисление действий, доступных в текущем состоянии (по одному на каждый вариант меню)
+
+    vector<AdvisorCandidate> candidateActions(Zoo& zoo) {
+        vector<AdvisorCandidate> candidates;
+        candidates.push_back({ false, ZooCommand{ ZooCommandType::NEXT_DAY }, L"Ничего не делать" });
+        auto add = [&](ZooCommand command, wstring description) {
+            if (candidates.size() < settings.maxCandidates) {
+                candidates.push_back({ true, move(command), move(description) });
+            }
+        };
+
+        if (zoo.canBuyAnimalToday()) {
+            for (size_t i = 0; i < zoo.marketSize(); i++) {
+                const Animal* animal = zoo.marketAnimal(i);
+                if (!zoo.ledger.canAfford(animal->price)) continue;
+                add({ ZooCommandType::BUY_ANIMAL, static_cast<int>(i + 1) },
+                    L"Купить животное: " + animal->name + L" (" + animal->climate + L", " + to_wstring(animal->price) + L" руб.)");
             }
         }
-        updateMaps();
-    }
 
-    void buyEnclosure() {
-        wcout << L"\n=== Покупка вольера ===" << endl;
-        wcout << L"Типы вольеров:" << endl;
-        for (const auto& entry : enclosureTypes) {
-            int id = entry.first;
-            const auto& data = entry.second;
-            wcout << id << L". " << get<3>(data) << L" (" << get<1>(data) << L" животных, " << get<2>(data) << L" руб.)" << endl;
+        set<wstring> neededClimates;
+        for (size_t i = 0; i < climates.size(); i++) {
+            if (zoo.aggregates.climatePopulation[i] > 0) neededClimates.insert(climates[i]);
+        }
+        for (size_t i = 0; i < zoo.marketSize(); i++) neededClimates.insert(zoo.marketAnimal(i)->climate);
+        const SpeciesCatalog& catalog = SpeciesCatalog::instance();
+        for (const auto& info : catalog.enclosureTypes()) {
+            if (!zoo.ledger.canAfford(info.price)) continue;
+            for (const auto& climate : neededClimates) {
+                add({ ZooCommandType::BUY_ENCLOSURE, info.choice, 0, climate },
+                    L"Купить вольер: " + info.name + L" (" + climate + L")");
+            }
         }
 
-        int typeChoice = safeInputInt(L"Выберите тип вольера (1-8 или 0 для отмены): ");
-        if (typeChoice < 1 || typeChoice > 8) return;
+        for (const auto& enclosure : zoo.enclosureList()) {
+            if (enclosure->isClean || !zoo.ledger.canAfford(enclosure->maintenanceCost)) continue;
+            add({ ZooCommandType::CLEAN_ENCLOSURE, enclosure->id },
+                L"Убрать вольер ID:" + to_wstring(enclosure->id));
+        }
 
-        set<wstring> neededClimates;
-        for (const auto& animal : animals) {
-            neededClimates.insert(animal->climate);
+        for (int type = WORKER_VET; type <= WORKER_GUIDE; type++) {
+            const WorkerTypeInfo& info = catalog.worker(static_cast<WorkerType>(type));
+            if (!zoo.ledger.canAfford(info.salary)) continue;
+            add({ ZooCommandType::HIRE_WORKER, type, 0, info.name }, L"Нанять работника: " + info.name);
         }
 
-        if (neededClimates.empty()) {
-            for (size_t i = 0; i < climates.size(); i++) {
-                wcout << (i + 1) << L". " << climates[i] << endl;
+        array<int, FOOD_TYPE_COUNT> need = zoo.dailyFoodNeed();
+        for (int option = 1; option <= 3; option++) {
+            for (int type = 0; type < FOOD_TYPE_COUNT; type++) {
+                if (need[type] == 0) continue;
+                add({ ZooCommandType::BUY_FOOD, option, type },
+                    L"Купить корм: " + foodTypeNames[type] + L" (вариант " + to_wstring(option) + L")");
             }
+            add({ ZooCommandType::ADVERTISE, option }, L"Заказать рекламу (вариант " + to_wstring(option) + L")");
         }
-        else {
-            int index = 1;
-            for (const auto& climate : neededClimates) {
-                wcout << index++ << L". " << climate << endl;
+
+        for (const auto& enclosure : zoo.enclosureList()) {
+            if (enclosure->containedAnimals.size() >= static_cast<size_t>(enclosure->capacity)) continue;
+            Animal* male = nullptr;
+            Animal* female = nullptr;
+            for (auto animal : enclosure->containedAnimals) {
+                if (!animal->canReproduce()) continue;
+                if (animal->gender == 'M' && !male) male = animal;
+                if (animal->gender == 'F' && !female && (!male || male->species == animal->species)) female = animal;
+            }
+            if (male && female && male->species == female->species) {
+                add({ ZooCommandType::BREED_ANIMALS, male->id, female->id },
+                    L"Размножить животных ID:" + to_wstring(male->id) + L" и ID:" + to_wstring(female->id));
             }
         }
-        int climateChoice = safeInputInt(L"Выберите климат (1-" + to_wstring(neededClimates.empty() ? climates.size() : neededClimates.size()) + L"): ");
-        if (climateChoice < 1 || climateChoice > static_cast<int>(neededClimates.empty() ? climates.size() : neededClimates.size())) return;
+        return candidates;
+    }
+};
 
-        wstring selectedClimate = neededClimates.empty() ? climates[climateChoice - 1] : *next(neededClimates.begin(), climateChoice - 1);
+#ifndef ZOOSIMS_CORE
+// Пул потоков консольной игры, советник и модель посетителей (создаются при первом обращении)
 
-        const auto& data = enclosureTypes.at(typeChoice);
-        EnclosureType type = get<0>(data);
-        int capacity = get<1>(data);
-        int price = get<2>(data);
+ThreadPool& consoleThreadPool() {
+    static ThreadPool pool;
+    return pool;
+}
 
-        if (money < price) {
-            wcout << L"Недостаточно денег для покупки!" << endl;
-            return;
+ZooAdvisor& consoleAdvisor() {
+    static ZooAdvisor advisor(consoleThreadPool());
+    return advisor;
+}
+
+shared_ptr<VisitorEngine> consoleVisitorEngine() {
+    static shared_ptr<VisitorEngine> engine = make_shared<VisitorEngine>(consoleThreadPool());
+    return engine;
+}
+
+// Показ совета и, по желанию игрока, выполнение рекомендованного действия
+
+void showAdvice(Zoo& zoo, ZooAdvisor& advisor) {
+    AdvisorRecommendation recommendation = advisor.recommend(zoo);
+    wcout << L"\n=== Совет управляющего ===" << endl;
+    wcout << L"Рекомендуется: " << recommendation.action.description << endl;
+    wcout << L"Ожидаемая оценка: " << static_cast<long long>(recommendation.expectedScore)
+        << L" (без действий: " << static_cast<long long>(recommendation.idleScore) << L")" << endl;
+    wcout << L"Проверено действий: " << recommendation.candidatesEvaluated << L", прогонов: " << recommendation.rollouts
+        << L" (не меньше " << recommendation.minSamples << L" на действие)"
+        << (recommendation.timedOut ? L", остановлено по времени" : L"") << endl;
+    if (!recommendation.action.hasAction) return;
+    if (safeInputInt(L"Выполнить? (1 - да, 0 - нет): ") == 1) {
+        zoo.execute(recommendation.action.command);
+    }
+}
+
+// Автопилот: каждый день выполняет рекомендованное действие и переходит к следующему дню
+
+void runAutopilot(Zoo& zoo, ZooAdvisor& advisor, int dayCount) {
+    for (int i = 0; i < dayCount && !zoo.isGameOver(); i++) {
+        AdvisorRecommendation recommendation = advisor.recommend(zoo);
+        if (recommendation.action.hasAction) {
+            wcout << L"Автопилот: " << recommendation.action.description << endl;
+            zoo.execute(recommendation.action.command);
         }
+        zoo.nextDay();
+    }
+}
 
-        int newId = nextEnclosureId++;
-        enclosures.push_back(make_unique<Enclosure>(newId, capacity, type, selectedClimate, price / 10));
-        money -= price;
-        wcout << L"Вы купили новый вольер (ID:" << newId << L") за " << price << L" руб." << endl;
-        updateMaps();
+// Полноэкранная панель зоопарка. Кадр рисуется в задний буфер ячеек, а в терминал
+// уходят только ячейки, изменившиеся с прошлого кадра, одной записью
+
+class TerminalDashboard {
+public:
+    TerminalDashboard(int columns = 100, int rows = 30)
+        : width(max(columns, 40)), height(max(rows, 12)),
+        back(static_cast<size_t>(width) * height), front(back.size()), fullRedraw(true), lastFrameSize(0) {
     }
 
-    void showEnclosures() {
-        wcout << L"\n=== Список вольеров ===" << endl;
-        if (enclosures.empty()) {
-            wcout << L"Вольеров нет" << endl;
-            return;
+// Отрисовка состояния зоопарка в задний буфер
+
+    void render(const Zoo& zoo) {
+        const vector<unique_ptr<Animal>>& animals = zoo.animalList();
+        const vector<unique_ptr<Enclosure>>& enclosures = zoo.enclosureList();
+        fill(back.begin(), back.end(), Cell());
+        wchar_t line[256];
+
+        swprintf(line, 256, L"=== %ls ===", zoo.name.c_str());
+        put(0, 0, line, COLOR_TITLE);
+        swprintf(line, 256, L"День: %d из %d   Баланс: %lld руб.   Корм: мясо %d, рыба %d, растительный %d",
+            zoo.days, zoo.victoryDays, zoo.ledger.balance(), zoo.foodStock[FOOD_MEAT], zoo.foodStock[FOOD_FISH], zoo.foodStock[FOOD_PLANTS]);
+        put(0, 1, line);
+        swprintf(line, 256, L"Популярность: %d   Посетители: %d чел.   Работники: %zu чел.",
+            zoo.popularity, zoo.visitors, zoo.workerList().size());
+        put(0, 2, line);
+
+        // Распределение по цветам счастья берется из гистограммы сводки зоопарка
+        const ZooAggregates& totals = zoo.aggregates;
+        array<int, COLOR_COUNT> byColor{};
+        for (int bucket = 0; bucket < ZooAggregates::happinessBuckets; bucket++) {
+            byColor[happinessColor(bucket * 20, true)] += totals.happinessHistogram[bucket];
         }
-        for (const auto& enclosure : enclosures) {
-            wcout << L"ID:" << enclosure->id << L" | " << enclosure->getTypeName()
-                << L" | Климат: " << enclosure->climate
-                << L" | Животных: " << enclosure->containedAnimals.size() << L"/" << enclosure->capacity
-                << L" | " << (enclosure->isClean ? L"Чистый" : L"Грязный") << endl;
+        byColor[COLOR_DEAD] = totals.deadAnimals;
+        swprintf(line, 256, L"Животные: %zu (больны: %d, мертвы: %d)   Вольеры: %zu",
+            animals.size(), totals.sickAnimals, totals.deadAnimals, enclosures.size());
+        put(0, 3, line);
+
+        put(0, 5, L"Счастье:", COLOR_TITLE);
+        int barWidth = width - 10;
+        int x = 9;
+        if (!animals.empty()) {
+            for (int color = COLOR_HAPPY; color <= COLOR_MISERABLE; color++) {
+                int cells = static_cast<int>(static_cast<long long>(byColor[color]) * barWidth / animals.size());
+                for (int i = 0; i < cells; i++) put(x++, 5, L"█", static_cast<TerminalColor>(color));
+            }
+        }
+        swprintf(line, 256, L"80+: %d   60+: %d   40+: %d   20+: %d   <20: %d",
+            byColor[COLOR_HAPPY], byColor[COLOR_CONTENT], byColor[COLOR_NEUTRAL], byColor[COLOR_UNHAPPY],
+            byColor[COLOR_MISERABLE]);
+        put(9, 6, line);
+
+        // Вольеры занимают половину оставшихся строк, остальное - карта животных
+        int row = 8;
+        int enclosureRows = min(static_cast<int>(enclosures.size()), (height - row - 2) / 2);
+        if (enclosureRows > 0) put(0, row++, L"Вольеры:", COLOR_TITLE);
+        for (int i = 0; i < enclosureRows; i++) {
+            const Enclosure& enclosure = *enclosures[i];
+            int total = 0;
+            int alive = 0;
+            for (auto animal : enclosure.containedAnimals) {
+                if (!animal->isAlive) continue;
+                total += animal->getDisplayedHappiness();
+                alive++;
+            }
+            int average = alive > 0 ? total / alive : 0;
+            swprintf(line, 256, L"#%-4d %-20ls %-12ls %3zu/%-3d %ls", enclosure.id, enclosure.getTypeName().c_str(),
+                enclosure.climate.c_str(), enclosure.containedAnimals.size(), enclosure.capacity,
+                enclosure.isClean ? L"" : L"грязно");
+            put(0, row, line);
+            swprintf(line, 256, L"%3d%%", average);
+            put(width - 5, row, line, happinessColor(average, alive > 0));
+            row++;
         }
+        renderAnimalMap(zoo, row + 1);
     }
 
-    void hireWorker() {
-        wcout << L"\n=== Наем работника ===" << endl;
-        wcout << L"Типы работников:" << endl;
-        for (const auto& entry : workerTypeNames) {
-            WorkerType type = entry.first;
-            wcout << static_cast<int>(type) + 1 << L". " << entry.second << L" (" << workerBaseSalaries.at(type) << L" руб./день)" << endl;
+// Вывод изменившихся ячеек одной записью в поток
+
+    void present(wostream& out) {
+        frame.clear();
+        if (fullRedraw) frame += L"\033[2J";
+        int cursorX = -1;
+        int cursorY = -1;
+        int currentColor = -1;
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                size_t index = static_cast<size_t>(y) * width + x;
+                if (!fullRedraw && back[index] == front[index]) continue;
+                if (y != cursorY || x != cursorX) {
+                    frame += L"\033[";
+                    frame += to_wstring(y + 1);
+                    frame += L';';
+                    frame += to_wstring(x + 1);
+                    frame += L'H';
+                }
+                if (back[index].color != currentColor) {
+                    currentColor = back[index].color;
+                    frame += terminalColorCodes[currentColor];
+                }
+                frame += back[index].ch;
+                front[index] = back[index];
+                cursorX = x + 1;
+                cursorY = y;
+            }
         }
+        fullRedraw = false;
+        lastFrameSize = frame.size();
+        if (frame.empty()) return;
+        frame += terminalColorCodes[COLOR_DEFAULT];
+        frame += L"\033[";
+        frame += to_wstring(height + 1);
+        frame += L";1H";
+        out.write(frame.data(), static_cast<streamsize>(frame.size()));
+        out.flush();
+    }
 
-        int typeChoice = safeInputInt(L"Выберите тип работника (1-5 или 0 для отмены): ");
-        if (typeChoice < 1 || typeChoice > 5) return;
+// Следующий кадр будет выведен целиком (например, после вывода поверх панели)
 
-        WorkerType type = static_cast<WorkerType>(typeChoice - 1);
-        if (money < workerBaseSalaries.at(type)) {
-            wcout << L"Недостаточно денег для найма!" << endl;
-            return;
+    void invalidate() { fullRedraw = true; }
+
+    size_t lastFrameCharacters() const { return lastFrameSize; }
+
+private:
+    struct Cell {
+        wchar_t ch = L' ';
+        uint8_t color = COLOR_DEFAULT;
+
+        bool operator==(const Cell& other) const { return ch == other.ch && color == other.color; }
+    };
+
+    int width;
+    int height;
+    vector<Cell> back;
+    vector<Cell> front;
+    wstring frame;
+    bool fullRedraw;
+    size_t lastFrameSize;
+
+    void put(int x, int y, const wchar_t* text, TerminalColor color = COLOR_DEFAULT) {
+        if (y < 0 || y >= height) return;
+        for (; *text && x < width; text++, x++) {
+            if (x < 0) continue;
+            Cell& cell = back[static_cast<size_t>(y) * width + x];
+            cell.ch = *text;
+            cell.color = color;
         }
+    }
 
-        wstring workerName = safeInputString(L"Введите имя работника: ");
-        workers.push_back(make_unique<Worker>(nextWorkerId++, workerName, type));
-        wcout << L"Вы наняли нового работника: " << workerName << L" (" << workerTypeNames.at(type) << L")" << endl;
-        updateMaps();
+// Карта животных: каждая ячейка - группа соседних животных, цвет по среднему счастью
+
+    void renderAnimalMap(const Zoo& zoo, int top) {
+        const vector<unique_ptr<Animal>>& animals = zoo.animalList();
+        int rows = height - top - 1;
+        if (rows <= 0 || animals.empty()) return;
+        put(0, top - 1, L"Животные:", COLOR_TITLE);
+        size_t cells = static_cast<size_t>(rows) * width;
+        size_t perCell = (animals.size() + cells - 1) / cells;
+        size_t cell = 0;
+        for (size_t first = 0; first < animals.size(); first += perCell, cell++) {
+            size_t last = min(first + perCell, animals.size());
+            int total = 0;
+            int alive = 0;
+            for (size_t i = first; i < last; i++) {
+                if (!animals[i]->isAlive) continue;
+                total += animals[i]->getDisplayedHappiness();
+                alive++;
+            }
+            TerminalColor color = happinessColor(alive > 0 ? total / alive : 0, alive > 0);
+            put(static_cast<int>(cell % width), top + static_cast<int>(cell / width), alive > 0 ? L"█" : L"░", color);
+        }
     }
+};
 
-    void showWorkers() {
-        wcout << L"\n=== Список работников ===" << endl;
-        if (workers.empty()) {
-            wcout << L"Работников нет" << endl;
-            return;
+// Живая панель: дни идут без остановки, кадры выводятся не чаще fps раз в секунду
+
+void runLiveDashboard(Zoo& zoo, int dayCount, int fps) {
+    using Clock = chrono::steady_clock;
+    TerminalDashboard dashboard;
+    const auto frameTime = chrono::microseconds(1000000 / max(fps, 1));
+    auto nextFrame = Clock::now();
+    wcout << L"\033[?25l";
+    for (int i = 0; i < dayCount && !zoo.isGameOver(); i++) {
+        {
+            SimOutputScope quiet(quietStream());
+            zoo.nextDay();
         }
-        for (const auto& worker : workers) {
-            wcout << L"ID:" << worker->id << L" | " << worker->name << L" | "
-                << worker->getTypeName() << L" | Зарплата: " << worker->salary << L" руб./день" << endl;
+        if (Clock::now() >= nextFrame) {
+            dashboard.render(zoo);
+            dashboard.present(wcout);
+            nextFrame = Clock::now() + frameTime;
         }
     }
+    dashboard.render(zoo);
+    dashboard.present(wcout);
+    wcout << L"\033[?25h" << endl;
+}
+#endif
+
+// Сводка состояния для интерфейса. Только простые поля, чтобы ее можно было копировать без блокировок
+
+struct ZooStatusSnapshot {
+    static const int maxMarket = 10;
+    static constexpr int maxDirty = 8;
+
+    struct MarketEntry {
+        wchar_t species[24];
+        int age;
+        int price;
+    };
+
+    int days = 0;
+    int victoryDays = 0;
+    long long money = 0;
+    int food[FOOD_TYPE_COUNT] = {};
+    int popularity = 0;
+    int visitors = 0;
+    int animals = 0;
+    int sickAnimals = 0;
+    int enclosures = 0;
+    int workers = 0;
+    int dirtyCount = 0;
+    int dirtyIds[maxDirty] = {};
+    int marketCount = 0;
+    MarketEntry market[maxMarket] = {};
+    int commandsApplied = 0;
+    int commandsRejected = 0;
+    bool gameOver = false;
+};
 
-    void buyFood() {
-        wcout << L"\n=== Покупка корма ===" << endl;
-        wcout << L"1. Маленькая упаковка (50 ед., 5,000 руб.)" << endl;
-        wcout << L"2. Средняя упаковка (100 ед., 9,000 руб.)" << endl;
-        wcout << L"3. Большая упаковка (200 ед., 16,000 руб.)" << endl;
+static_assert(is_trivially_copyable<ZooStatusSnapshot>::value, "snapshot is copied word by word");
 
-        int choice = safeInputInt(L"Выберите вариант (1-3 или 0 для отмены): ");
-        if (choice < 1 || choice > 3) return;
+// Режим реального времени: отдельный поток двигает дни с заданным интервалом, команды игрока
+// приходят через CommandQueue и применяются на границе дней, а интерфейс читает последнюю
+// опубликованную сводку из двойного буфера (запись идет в неопубликованную половину,
+// читатель сверяет номер версии и при совпадении с записью просто повторяет копирование)
 
-        int amount = 0;
-        int cost = 0;
-        switch (choice) {
-        case 1: amount = 50; cost = 5000; break;
-        case 2: amount = 100; cost = 9000; break;
-        case 3: amount = 200; cost = 16000; break;
-        }
+class RealTimeZoo {
+public:
+    RealTimeZoo(Zoo& target, int dayIntervalMs)
+        : zoo(target), interval(dayIntervalMs), running(false), current(0), applied(0), rejected(0) {
+        publish();
+    }
 
-        if (money < cost) {
-            wcout << L"Недостаточно денег для покупки!" << endl;
-            return;
-        }
+    ~RealTimeZoo() { stop(); }
 
-        food += amount;
-        money -= cost;
-        wcout << L"Вы купили " << amount << L" единиц корма за " << cost << L" руб." << endl;
-    }
+    RealTimeZoo(const RealTimeZoo&) = delete;
+    RealTimeZoo& operator=(const RealTimeZoo&) = delete;
 
-    void advertise() {
-        wcout << L"\n=== Реклама зоопарка ===" << endl;
-        wcout << L"1. Бюджетная реклама (+1 популярность, 5,000 руб.)" << endl;
-        wcout << L"2. Стандартная реклама (+3 популярность, 15,000 руб.)" << endl;
-        wcout << L"3. Широкая рекламная кампания (+7 популярность, 30,000 руб.)" << endl;
+    void start() {
+        if (running.exchange(true)) return;
+        simulation = thread(&RealTimeZoo::run, this);
+    }
 
-        int choice = safeInputInt(L"Выберите вариант (1-3 или 0 для отмены): ");
-        if (choice < 1 || choice > 3) return;
+// Остановка потока симуляции; после нее зоопарком снова владеет вызывающий поток
 
-        int popIncrease = 0;
-        int cost = 0;
-        switch (choice) {
-        case 1: popIncrease = 1; cost = 5000; break;
-        case 2: popIncrease = 3; cost = 15000; break;
-        case 3: popIncrease = 7; cost = 30000; break;
+    void stop() {
+        if (!running.exchange(false)) return;
+        {
+            lock_guard<mutex> lock(wakeMutex);
         }
+        wake.notify_all();
+        simulation.join();
+        ZooCommand command;
+        while (commands.pop(command)) applyCommand(command);
+        publish();
+    }
 
-        if (money < cost) {
-            wcout << L"Недостаточно денег для рекламы!" << endl;
-            return;
+    void submit(ZooCommand command) { commands.push(move(command)); }
+
+    void setDayInterval(int dayIntervalMs) { interval.store(max(dayIntervalMs, 0), memory_order_relaxed); }
+
+// Последняя опубликованная сводка (не ждет поток симуляции)
+
+    ZooStatusSnapshot status() const {
+        while (true) {
+            const PublishedStatus& slot = slots[current.load(memory_order_acquire)];
+            unsigned version = slot.version.load(memory_order_acquire);
+            if (version & 1) continue;
+            uint64_t words[statusWords];
+            for (size_t i = 0; i < statusWords; i++) words[i] = slot.words[i].load(memory_order_relaxed);
+            atomic_thread_fence(memory_order_acquire);
+            if (slot.version.load(memory_order_relaxed) != version) continue;
+            ZooStatusSnapshot copy;
+            memcpy(&copy, words, sizeof(copy));
+            return copy;
         }
+    }
 
-        popularity += popIncrease;
-        money -= cost;
-        wcout << L"Рекламная кампания успешно проведена! Популярность увеличилась на " << popIncrease << L"." << endl;
+private:
+    static const size_t statusWords = (sizeof(ZooStatusSnapshot) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    // Сводка хранится атомарными словами: копирование во время записи не является гонкой данных
+    struct PublishedStatus {
+        atomic<unsigned> version{ 0 };
+        atomic<uint64_t> words[statusWords] = {};
+    };
+
+    Zoo& zoo;
+    CommandQueue commands;
+    atomic<int> interval;
+    atomic<bool> running;
+    thread simulation;
+    mutex wakeMutex;
+    condition_variable wake;
+    PublishedStatus slots[2];
+    atomic<int> current;
+    int applied;
+    int rejected;
+
+    void applyCommand(const ZooCommand& command) {
+        SimOutputScope quiet(quietStream());
+        if (zoo.execute(command)) applied++;
+        else rejected++;
     }
 
-    void showAnimalHappiness() {
-        wcout << L"\n=== Уровень счастья животных ===" << endl;
-        if (animals.empty()) {
-            wcout << L"Животных нет" << endl;
-            return;
-        }
-        for (const auto& animal : animals) {
-            wstring genderStr = (animal->gender == 'M') ? L"Самец" : L"Самка";
-            wcout << animal->name << L" (" << genderStr << L", ID:" << animal->id << L") - "
-                << animal->getHappinessColor() << animal->getDisplayedHappiness() << L"%\033[0m" << endl;
+    void run() {
+        using Clock = chrono::steady_clock;
+        auto nextTick = Clock::now();
+        while (running.load(memory_order_acquire) && !zoo.isGameOver()) {
+            ZooCommand command;
+            while (commands.pop(command)) applyCommand(command);
+            {
+                SimOutputScope quiet(quietStream());
+                zoo.nextDay();
+            }
+            publish();
+            nextTick += chrono::milliseconds(interval.load(memory_order_relaxed));
+            if (nextTick < Clock::now()) nextTick = Clock::now();
+            unique_lock<mutex> lock(wakeMutex);
+            wake.wait_until(lock, nextTick, [this] { return !running.load(memory_order_acquire); });
         }
+        publish();
     }
 
-    void refreshMarketForMoney() {
-        if (money < marketRefreshCost) {
-            wcout << L"Недостаточно денег для обновления рынка!" << endl;
-            return;
+    void publish() {
+        ZooStatusSnapshot snapshot;
+        const Zoo& state = zoo;
+        snapshot.days = state.days;
+        snapshot.victoryDays = state.victoryDays;
+        snapshot.money = state.ledger.balance();
+        for (int type = 0; type < FOOD_TYPE_COUNT; type++) snapshot.food[type] = state.foodStock[type];
+        snapshot.popularity = state.popularity;
+        snapshot.visitors = state.visitors;
+        snapshot.animals = static_cast<int>(state.animalList().size());
+        snapshot.sickAnimals = state.aggregates.sickAnimals;
+        snapshot.enclosures = static_cast<int>(state.enclosureList().size());
+        for (const auto& enclosure : state.enclosureList()) {
+            if (enclosure->isClean) continue;
+            if (snapshot.dirtyCount < ZooStatusSnapshot::maxDirty) snapshot.dirtyIds[snapshot.dirtyCount] = enclosure->id;
+            snapshot.dirtyCount++;
         }
-        money -= marketRefreshCost;
-        refreshMarket();
+        snapshot.workers = static_cast<int>(state.workerList().size());
+        snapshot.marketCount = static_cast<int>(min<size_t>(state.marketSize(), ZooStatusSnapshot::maxMarket));
+        for (int i = 0; i < snapshot.marketCount; i++) {
+            const Animal* animal = state.marketAnimal(i);
+            ZooStatusSnapshot::MarketEntry& entry = snapshot.market[i];
+            swprintf(entry.species, 24, L"%ls", animal->name.c_str());
+            entry.age = animal->age;
+            entry.price = animal->price;
+        }
+        snapshot.commandsApplied = applied;
+        snapshot.commandsRejected = rejected;
+        snapshot.gameOver = state.isGameOver();
+
+        int next = 1 - current.load(memory_order_relaxed);
+        PublishedStatus& slot = slots[next];
+        unsigned version = slot.version.load(memory_order_relaxed);
+        uint64_t words[statusWords] = {};
+        memcpy(words, &snapshot, sizeof(snapshot));
+        slot.version.store(version + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        for (size_t i = 0; i < statusWords; i++) slot.words[i].store(words[i], memory_order_relaxed);
+        slot.version.store(version + 2, memory_order_release);
+        current.store(next, memory_order_release);
     }
+};
 
-    void nextDay() {
-        try {
-            days++;
-            animalsBoughtToday = 0;
-            wcout << L"\n=== День " << days << L" ===" << endl;
-
-            // Обновление возраста и проверка здоровья животных
-            for (auto it = animals.begin(); it != animals.end(); ) {
-                (*it)->age++;
-                (*it)->checkDisease();
-
-                if ((*it)->checkAge()) {
-                    for (auto& enclosure : enclosures) {
-                        enclosure->removeAnimal((*it)->id);
-                    }
-                    it = animals.erase(it);
-                }
-                else {
-                    ++it;
-                }
-            }
+#ifdef ZOOSIMS_CORE
+// C-интерфейс библиотеки ядра (см. ZooSIMS.h). Столбцы не копируют данные: зоопарк
+// хранит только массивы указателей на объекты животных и вольеров, которые
+// перестраиваются при первом запросе столбца после шага или команды
+
+static_assert(ZOOSIMS_FAST_FORWARD == static_cast<int>(ZooCommandType::FAST_FORWARD), "ZooSimsCommand is out of sync");
+
+struct ZooSimsZoo {
+    unique_ptr<Zoo> zoo;
+    vector<const void*> animalRows;
+    vector<const void*> enclosureRows;
+    bool rowsStale = true;
+
+    void refreshRows() {
+        if (!rowsStale) return;
+        zoo->ensureEntities();
+        animalRows.assign(zoo->animals.size(), nullptr);
+        for (size_t i = 0; i < zoo->animals.size(); i++) animalRows[i] = zoo->animals[i].get();
+        enclosureRows.assign(zoo->enclosures.size(), nullptr);
+        for (size_t i = 0; i < zoo->enclosures.size(); i++) enclosureRows[i] = zoo->enclosures[i].get();
+        rowsStale = false;
+    }
+};
 
-            // Обновление состояния вольеров
-            for (auto& enclosure : enclosures) {
-                enclosure->updateCleanliness();
-                enclosure->spreadDisease();
-            }
+// Столбец поля field по строкам rows (объекты типа T). Смещение берется у первой строки
 
-            // Работа работников
-            for (auto& worker : workers) {
-                worker->performDuties(this);
-            }
+template <typename T, typename Field>
+ZooSimsColumn makeColumn(const vector<const void*>& rows, Field T::* field) {
+    static_assert(sizeof(Field) == 1 || sizeof(Field) == 4, "column values are uint8 or int32");
+    ZooSimsColumn column{ rows.data(), rows.size(), 0, sizeof(Field) == 1 ? ZOOSIMS_UINT8 : ZOOSIMS_INT32 };
+    if (!rows.empty()) {
+        const T& first = *static_cast<const T*>(rows[0]);
+        column.offset = static_cast<size_t>(reinterpret_cast<const char*>(&(first.*field)) - reinterpret_cast<const char*>(&first));
+    }
+    return column;
+}
 
-            // Обновление счастья животных
-            for (auto& enclosure : enclosures) {
-                bool isFed = (food >= static_cast<int>(animals.size()));
-                for (auto animal : enclosure->containedAnimals) {
-                    bool isAlone = enclosure->containedAnimals.size() == 1;
-                    animal->updateHappiness(isFed, isAlone, enclosure->isClean);
-                }
-            }
+extern "C" {
 
-            // Проверка на побег животных
-            for (auto& enclosure : enclosures) {
-                for (auto it = enclosure->containedAnimals.begin(); it != enclosure->containedAnimals.end(); ) {
-                    if ((*it)->tryEscape()) {
-                        animals.erase(remove_if(animals.begin(), animals.end(),
-                            [&](const unique_ptr<Animal>& a) { return a->id == (*it)->id; }), animals.end());
-                        it = enclosure->containedAnimals.erase(it);
-                    }
-                    else {
-                        ++it;
-                    }
-                }
-            }
+ZooSimsZoo* zoosims_create(const char* zooName, const char* directorName, int victoryDays) {
+    try {
+        SimOutputScope quiet(quietStream());
+        auto handle = make_unique<ZooSimsZoo>();
+        handle->zoo = make_unique<Zoo>(decodeUtf8(zooName ? zooName : ""), decodeUtf8(directorName ? directorName : ""), victoryDays);
+        return handle.release();
+    }
+    catch (...) {
+        return nullptr;
+    }
+}
 
-            // Кормление животных
-            if (!animals.empty()) {
-                int food_needed = static_cast<int>(animals.size());
-                if (food >= food_needed) {
-                    food -= food_needed;
-                    wcout << L"Животные накормлены. Остаток еды: " << food << L" ед." << endl;
-                }
-                else {
-                    food = 0;
-                    wcout << L"Предупреждение: не хватает еды для всех животных!" << endl;
-                }
-            }
+void zoosims_destroy(ZooSimsZoo* zoo) {
+    delete zoo;
+}
 
-            // Расчет посетителей и дохода
-            visitors = min(2 * popularity, 1000);
-            int income = visitors * static_cast<int>(animals.size()) * 100;
-            money += income;
+int zoosims_step(ZooSimsZoo* zoo, int days) {
+    if (!zoo) return 0;
+    try {
+        SimOutputScope quiet(quietStream());
+        zoo->rowsStale = true;
+        for (int i = 0; i < days && !zoo->zoo->isGameOver(); i++) zoo->zoo->nextDay();
+        return zoo->zoo->isGameOver() ? 0 : 1;
+    }
+    catch (...) {
+        return 0;
+    }
+}
 
-            // Изменение популярности
-            popularity = max(0, popularity + (rand() % 3 - 1));
+int zoosims_command(ZooSimsZoo* zoo, int command, int arg1, int arg2, const char* text) {
+    if (!zoo || command < ZOOSIMS_NEXT_DAY || command > ZOOSIMS_FAST_FORWARD) return 0;
+    try {
+        SimOutputScope quiet(quietStream());
+        zoo->rowsStale = true;
+        return zoo->zoo->execute({ static_cast<ZooCommandType>(command), arg1, arg2, decodeUtf8(text ? text : "") }) ? 1 : 0;
+    }
+    catch (...) {
+        return 0;
+    }
+}
 
-            wcout << L"Популярность зоопарка: " << popularity << endl;
-            wcout << L"Посетители сегодня: " << visitors << L" чел." << endl;
-            wcout << L"Доход от посетителей: " << income << L" руб." << endl;
+void zoosims_seed(unsigned seed) {
+    seedSimRandom(seed);
+}
 
-            // Выплата зарплат
-            payWorkers();
+int zoosims_summary(ZooSimsZoo* zoo, ZooSimsSummary* summary) {
+    if (!zoo || !summary) return 0;
+    zoo->refreshRows();
+    const Zoo& state = *zoo->zoo;
+    summary->money = state.ledger.balance();
+    summary->day = state.days;
+    summary->popularity = state.popularity;
+    summary->visitors = state.visitors;
+    summary->animals = static_cast<int32_t>(state.animals.size());
+    summary->enclosures = static_cast<int32_t>(state.enclosures.size());
+    summary->workers = static_cast<int32_t>(state.workers.size());
+    summary->gameOver = state.isGameOver() ? 1 : 0;
+    return 1;
+}
 
-            // Показать счастье животных
-            showAnimalHappiness();
+ZooSimsColumn zoosims_animal_column(ZooSimsZoo* zoo, int column) {
+    if (!zoo) return ZooSimsColumn{ nullptr, 0, 0, ZOOSIMS_INT32 };
+    zoo->refreshRows();
+    const vector<const void*>& rows = zoo->animalRows;
+    switch (column) {
+    case ZOOSIMS_ANIMAL_ID: return makeColumn(rows, &Animal::id);
+    case ZOOSIMS_ANIMAL_SPECIES: return makeColumn(rows, &Animal::speciesId);
+    case ZOOSIMS_ANIMAL_AGE: return makeColumn(rows, &Animal::age);
+    case ZOOSIMS_ANIMAL_WEIGHT: return makeColumn(rows, &Animal::weight);
+    case ZOOSIMS_ANIMAL_PRICE: return makeColumn(rows, &Animal::price);
+    case ZOOSIMS_ANIMAL_HAPPINESS: return makeColumn(rows, &Animal::trueHappiness);
+    case ZOOSIMS_ANIMAL_HEALTH: return makeColumn(rows, &Animal::health);
+    case ZOOSIMS_ANIMAL_ALIVE: return makeColumn(rows, &Animal::isAlive);
+    case ZOOSIMS_ANIMAL_DAYS_SICK: return makeColumn(rows, &Animal::daysSick);
+    default: return ZooSimsColumn{ nullptr, 0, 0, ZOOSIMS_INT32 };
+    }
+}
 
-            // Проверка условий окончания игры
-            if (food == 0 && !animals.empty()) {
-                wcout << L"Все животные умерли от голода! Игра окончена." << endl;
-                exit(0);
-            }
+ZooSimsColumn zoosims_enclosure_column(ZooSimsZoo* zoo, int column) {
+    if (!zoo) return ZooSimsColumn{ nullptr, 0, 0, ZOOSIMS_INT32 };
+    zoo->refreshRows();
+    const vector<const void*>& rows = zoo->enclosureRows;
+    switch (column) {
+    case ZOOSIMS_ENCLOSURE_ID: return makeColumn(rows, &Enclosure::id);
+    case ZOOSIMS_ENCLOSURE_TYPE: return makeColumn(rows, &Enclosure::type);
+    case ZOOSIMS_ENCLOSURE_CAPACITY: return makeColumn(rows, &Enclosure::capacity);
+    case ZOOSIMS_ENCLOSURE_MAINTENANCE: return makeColumn(rows, &Enclosure::maintenanceCost);
+    case ZOOSIMS_ENCLOSURE_CLEAN: return makeColumn(rows, &Enclosure::isClean);
+    default: return ZooSimsColumn{ nullptr, 0, 0, ZOOSIMS_INT32 };
+    }
+}
 
-            if (money < 0) {
-                wcout << L"Вы банкрот! Игра окончена." << endl;
-                exit(0);
-            }
+int zoosims_load_catalog(const char* text) {
+    if (!text) return 0;
+    try {
+        wstring error;
+        return SpeciesCatalog::configure(decodeUtf8(text), error) ? 1 : 0;
+    }
+    catch (...) {
+        return 0;
+    }
+}
 
-            if (days >= victoryDays) {
-                wcout << L"Поздравляем! Вы успешно управляли зоопарком " << victoryDays << L" дней!" << endl;
-                exit(0);
-            }
+const char* zoosims_species_name(int speciesId) {
+    static const vector<string> names = [] {
+        const SpeciesCatalog& catalog = SpeciesCatalog::instance();
+        vector<string> result(catalog.size());
+        for (size_t i = 0; i < catalog.size(); i++) result[i] = encodeUtf8(catalog.at(static_cast<int>(i)).name);
+        return result;
+    }();
+    if (speciesId < 0 || static_cast<size_t>(speciesId) >= names.size()) return nullptr;
+    return names[speciesId].c_str();
+}
 
-            // Периодическое обновление рынка
-            if (days % 3 == 0) {
-                refreshMarket();
-            }
-        }
-        catch (const std::bad_alloc& e) {
-            wcout << L"Ошибка памяти! Слишком много объектов." << endl;
-            wcout << L"Попробуйте продать некоторых животных или уволить работников." << endl;
+}
+#else
+
+// Консольный режим реального времени: дни идут сами, ввод игрока не останавливает симуляцию
+
+void runRealTimeMode(Zoo& zoo) {
+    RealTimeZoo realTime(zoo, max(safeInputInt(L"Длительность дня в миллисекундах: "), 0));
+    realTime.start();
+    while (true) {
+        ZooStatusSnapshot status = realTime.status();
+        wcout << L"\n=== Реальное время: день " << status.days << L" из " << status.victoryDays << L" ===" << endl;
+        wcout << L"Баланс: " << status.money << L" руб. | Корм: " << status.food[FOOD_MEAT] << L"/" << status.food[FOOD_FISH]
+            << L"/" << status.food[FOOD_PLANTS] << L" ед. | Популярность: "
+            << status.popularity << L" | Посетители: " << status.visitors << endl;
+        wcout << L"Животные: " << status.animals << L" (больны: " << status.sickAnimals << L") | Вольеры: "
+            << status.enclosures << L" | Работники: " << status.workers << endl;
+        if (status.dirtyCount > 0) {
+            wcout << L"Грязные вольеры (" << status.dirtyCount << L"):";
+            for (int i = 0; i < min(status.dirtyCount, ZooStatusSnapshot::maxDirty); i++) wcout << L" ID:" << status.dirtyIds[i];
+            wcout << endl;
         }
-        catch (const std::exception& e) {
-            wcout << L"Ошибка: " << e.what() << endl;
+        wcout << L"Рынок:";
+        for (int i = 0; i < status.marketCount; i++) {
+            wcout << L" " << i + 1 << L"." << status.market[i].species << L"(" << status.market[i].price << L")";
         }
-    }
+        wcout << endl;
+        wcout << L"Команд выполнено: " << status.commandsApplied << L", отклонено: " << status.commandsRejected << endl;
+        if (status.gameOver) break;
 
-    void payWorkers() {
-        int totalSalary = 0;
-        for (const auto& worker : workers) {
-            totalSalary += worker->salary;
+        wcout << L"1. Купить животное  2. Продать животное  3. Нанять работника  4. Убрать вольер" << endl;
+        wcout << L"5. Купить еду  6. Изменить скорость  7. Обновить  0. Выйти из режима" << endl;
+        int choice = safeInputInt(L"Выберите действие: ");
+        if (choice == 0) break;
+        switch (choice) {
+        case 1: {
+            int position = safeInputInt(L"Номер животного на рынке: ");
+            realTime.submit({ ZooCommandType::BUY_ANIMAL, position, 0, wstring() });
+            break;
         }
-
-        if (money < totalSalary) {
-            wcout << L"Недостаточно денег для выплаты зарплат! Работники увольняются." << endl;
-            workers.clear();
-            workersMap.clear();
-            return;
+        case 2: {
+            int animalId = safeInputInt(L"ID животного: ");
+            realTime.submit({ ZooCommandType::SELL_ANIMAL, animalId, 0, wstring() });
+            break;
         }
-
-        money -= totalSalary;
-        wcout << L"Выплачено зарплат работникам: " << totalSalary << L" руб." << endl;
-    }
-};
-
-void Worker::performDuties(Zoo* zoo) {
-    switch (type) {
-    case WORKER_CLEANER:
-        cleanEnclosures(zoo->enclosures);
-        break;
-    case WORKER_VET:
-        for (auto& animal : zoo->animals) {
-            if (animal->getHealth() == AnimalHealth::SICK) {
-                if (rand() % 100 < 70) {
-                    animal->health = AnimalHealth::HEALTHY;
-                    animal->hasDisease = false;
-                    animal->daysSick = 0;
-                }
+        case 3: {
+            int type = safeInputInt(L"Тип работника (1-5): ") - 1;
+            if (type < WORKER_VET || type > WORKER_GUIDE) {
+                wcout << L"Неверный тип работника!" << endl;
+                break;
             }
+            wstring workerName = safeInputString(L"Имя работника: ");
+            realTime.submit({ ZooCommandType::HIRE_WORKER, type, 0, workerName });
+            break;
         }
-        wcout << name << L" проверил здоровье всех животных." << endl;
-        break;
-    case WORKER_FEEDER:
-        if (zoo->food >= (int)zoo->animals.size()) {
-            zoo->food -= (int)zoo->animals.size();
-            wcout << name << L" накормил всех животных." << endl;
+        case 4: {
+            int enclosureId = safeInputInt(L"ID вольера: ");
+            realTime.submit({ ZooCommandType::CLEAN_ENCLOSURE, enclosureId, 0, wstring() });
+            break;
+        }
+        case 5: {
+            int type = safeInputInt(L"Тип корма (1 - мясо, 2 - рыба, 3 - растительный): ") - 1;
+            int option = safeInputInt(L"Вариант (1-3): ");
+            realTime.submit({ ZooCommandType::BUY_FOOD, option, type, wstring() });
+            break;
+        }
+        case 6: realTime.setDayInterval(safeInputInt(L"Длительность дня в миллисекундах: ")); break;
+        case 7: break;
+        default: wcout << L"Неверный выбор!" << endl;
         }
-        else {
-            wcout << name << L" не смог накормить животных - недостаточно еды!" << endl;
-        }
-        break;
-    case WORKER_TRAINER:
-        zoo->popularity += 2;
-        wcout << name << L" провел дрессировку. Популярность +2." << endl;
-        break;
-    case WORKER_GUIDE:
-        zoo->popularity += 3;
-        zoo->money += zoo->visitors * 100;
-        wcout << name << L" провел экскурсию. Популярность +3, доход " << zoo->visitors * 100 << L" руб." << endl;
-        break;
     }
+    realTime.stop();
+    if (zoo.isGameOver()) wcout << L"Игра окончена на дне " << zoo.days << L"." << endl;
 }
 
 int wmain() {
-    srand(static_cast<unsigned>(time(0)));
+    seedSimRandom(static_cast<unsigned>(time(0)));
     setlocale(LC_ALL, "ru_RU.UTF-8");
     (void)_setmode(_fileno(stdout), _O_U16TEXT);
     (void)_setmode(_fileno(stdin), _O_U16TEXT);
     (void)_setmode(_fileno(stderr), _O_U16TEXT);
 
     wcout << L"=== Добро пожаловать в ZooSIMS ===" << endl;
-    wcout << L"Введите название вашего зоопарка: ";
-    wstring name;
-    getline(wcin, name);
 
-    Zoo zoo(name, 100);
+    // Журнал сохраняет игру после каждого дня и действия; после сбоя ее можно восстановить
+    const string savePath = "zoosims_save";
+    unique_ptr<Zoo> savedZoo;
+    if (ZooJournal::hasSavedGame(savePath) &&
+        safeInputInt(L"Найдена сохраненная игра. Восстановить? (1 - да, 0 - нет): ") == 1) {
+        savedZoo = ZooJournal::recover(savePath);
+        if (!savedZoo) wcout << L"Не удалось восстановить игру, начинаем новую." << endl;
+    }
+    if (!savedZoo) {
+        wcout << L"Введите название вашего зоопарка: ";
+        wstring name;
+        getline(wcin, name);
+        savedZoo = make_unique<Zoo>(name, 100);
+    }
+    Zoo& zoo = *savedZoo;
+    ZooJournal journal(savePath);
+    journal.attach(zoo);
+    bool saveErrorShown = false;
 
     while (true) {
+        zoo.journalChanges(0);
+        if (!saveErrorShown && journal.hasWriteError()) {
+            wcout << L"Внимание: не удалось записать сохранение на диск, игра может не восстановиться." << endl;
+            saveErrorShown = true;
+        }
         zoo.showMainMenu();
         int choice = safeInputInt(L"Выберите действие: ");
 
@@ -1370,6 +7408,8 @@ int wmain() {
             switch (subChoice) {
             case 1: zoo.buyEnclosure(); break;
             case 2: zoo.showEnclosures(); break;
+            case 3: zoo.cleanEnclosure(); break;
+            case 4: zoo.showMap(); break;
             case 0: break;
             default: wcout << L"Неверный выбор!" << endl;
             }
@@ -1388,10 +7428,38 @@ int wmain() {
         }
         case 4: zoo.buyFood(); break;
         case 5: zoo.advertise(); break;
-        case 6: zoo.nextDay(); break;
+        case 6:
+            zoo.nextDay();
+            if (zoo.isGameOver()) return 0;
+            break;
         case 7: zoo.showAnimalHappiness(); break;
+        case 8: zoo.showHistory(); break;
+        case 15: zoo.showFinances(); break;
+        case 16: zoo.setShiftTicks(zoo.getShiftTicks() > 0 ? 0 : 5); break;
+        case 17:
+            zoo.fastForwardDays();
+            if (zoo.isGameOver()) return 0;
+            break;
+        case 18: zoo.showDefragmentation(); break;
+        case 10: showAdvice(zoo, consoleAdvisor()); break;
+        case 11:
+            runAutopilot(zoo, consoleAdvisor(), safeInputInt(L"Сколько дней вести зоопарк автоматически: "));
+            if (zoo.isGameOver()) return 0;
+            break;
+        case 12:
+            runLiveDashboard(zoo, safeInputInt(L"Сколько дней показать на панели: "), 30);
+            if (zoo.isGameOver()) return 0;
+            break;
+        case 13:
+            runRealTimeMode(zoo);
+            if (zoo.isGameOver()) return 0;
+            break;
+        case 14:
+            zoo.attachVisitorEngine(zoo.hasVisitorEngine() ? nullptr : consoleVisitorEngine());
+            break;
         case 9: return 0;
         default: wcout << L"Неверный выбор!" << endl;
         }
     }
 }
+#endif
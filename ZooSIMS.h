@@ -0,0 +1,142 @@
+#ifndef ZOOSIMS_H
+#define ZOOSIMS_H
+
+/*
+ * C-интерфейс ядра симуляции ZooSIMS (сборка ZooSIMS.cpp с флагом ZOOSIMS_CORE).
+ * Ядро не работает с консолью: сообщения симуляции отбрасываются, ввод не запрашивается.
+ * Строки передаются в UTF-8. Один зоопарк нельзя одновременно использовать из нескольких потоков,
+ * разные зоопарки независимы.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(_WIN32) && defined(ZOOSIMS_SHARED)
+#ifdef ZOOSIMS_CORE
+#define ZOOSIMS_API __declspec(dllexport)
+#else
+#define ZOOSIMS_API __declspec(dllimport)
+#endif
+#else
+#define ZOOSIMS_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ZooSimsZoo ZooSimsZoo;
+
+/* Команды игрока, порядок совпадает с ZooCommandType */
+enum ZooSimsCommand {
+    ZOOSIMS_NEXT_DAY,
+    ZOOSIMS_BUY_ANIMAL,      /* arg1 - позиция на рынке (1..) */
+    ZOOSIMS_SELL_ANIMAL,     /* arg1 - ID животного */
+    ZOOSIMS_RENAME_ANIMAL,   /* arg1 - ID животного, text - новое имя */
+    ZOOSIMS_BREED_ANIMALS,   /* arg1, arg2 - ID родителей */
+    ZOOSIMS_REFRESH_MARKET,
+    ZOOSIMS_BUY_ENCLOSURE,   /* arg1 - номер типа в каталоге, text - климат */
+    ZOOSIMS_HIRE_WORKER,     /* arg1 - тип работника, text - имя */
+    ZOOSIMS_BUY_FOOD,        /* arg1 - размер упаковки (1-3), arg2 - тип корма */
+    ZOOSIMS_ADVERTISE,       /* arg1 - вариант рекламы (1-3) */
+    ZOOSIMS_CLEAN_ENCLOSURE, /* arg1 - ID вольера */
+    ZOOSIMS_FAST_FORWARD     /* arg1 - целевой день, перемотка останавливается раньше на событиях */
+};
+
+/* Тип значения в столбце */
+enum ZooSimsValueType {
+    ZOOSIMS_INT32,
+    ZOOSIMS_UINT8
+};
+
+/* Столбцы животных */
+enum ZooSimsAnimalColumn {
+    ZOOSIMS_ANIMAL_ID,
+    ZOOSIMS_ANIMAL_SPECIES,     /* номер вида, имя - zoosims_species_name */
+    ZOOSIMS_ANIMAL_AGE,
+    ZOOSIMS_ANIMAL_WEIGHT,
+    ZOOSIMS_ANIMAL_PRICE,
+    ZOOSIMS_ANIMAL_HAPPINESS,
+    ZOOSIMS_ANIMAL_HEALTH,      /* 0 - здоров, 1 - болен, 2 - мертв */
+    ZOOSIMS_ANIMAL_ALIVE,       /* uint8 */
+    ZOOSIMS_ANIMAL_DAYS_SICK,
+    ZOOSIMS_ANIMAL_COLUMN_COUNT
+};
+
+/* Столбцы вольеров */
+enum ZooSimsEnclosureColumn {
+    ZOOSIMS_ENCLOSURE_ID,
+    ZOOSIMS_ENCLOSURE_TYPE,
+    ZOOSIMS_ENCLOSURE_CAPACITY,
+    ZOOSIMS_ENCLOSURE_MAINTENANCE,
+    ZOOSIMS_ENCLOSURE_CLEAN,    /* uint8 */
+    ZOOSIMS_ENCLOSURE_COLUMN_COUNT
+};
+
+/*
+ * Столбец без копирования: значение строки i лежит по адресу (const char*)rows[i] + offset
+ * прямо в объектах симуляции. Столбец действителен до следующего вызова step/command/destroy
+ * для этого зоопарка. При ошибке count = 0 и rows = NULL.
+ */
+typedef struct ZooSimsColumn {
+    const void* const* rows;
+    size_t count;
+    size_t offset;
+    int valueType;
+} ZooSimsColumn;
+
+typedef struct ZooSimsSummary {
+    int64_t money;
+    int32_t day;
+    int32_t popularity;
+    int32_t visitors;
+    int32_t animals;
+    int32_t enclosures;
+    int32_t workers;
+    int32_t gameOver;
+} ZooSimsSummary;
+
+/* Создание зоопарка без консольного ввода. NULL при ошибке */
+ZOOSIMS_API ZooSimsZoo* zoosims_create(const char* zooName, const char* directorName, int victoryDays);
+ZOOSIMS_API void zoosims_destroy(ZooSimsZoo* zoo);
+
+/* Продвижение на несколько дней. 1, пока игра не окончена */
+ZOOSIMS_API int zoosims_step(ZooSimsZoo* zoo, int days);
+
+/* Команда игрока (см. ZooSimsCommand). 1, если выполнена */
+ZOOSIMS_API int zoosims_command(ZooSimsZoo* zoo, int command, int arg1, int arg2, const char* text);
+
+/*
+ * Каталог видов, типов вольеров и работников из текста в UTF-8 (формат zoo_catalog.txt).
+ * Ядро не читает zoo_catalog.txt: без этого вызова используется встроенный каталог.
+ * Вызывается до создания первого зоопарка. 1, если каталог принят; 0, если в тексте ошибка
+ * или каталог уже используется (тогда остается прежний)
+ */
+ZOOSIMS_API int zoosims_load_catalog(const char* text);
+
+/* Генератор случайных чисел симуляции общий для всех зоопарков вызывающего потока */
+ZOOSIMS_API void zoosims_seed(unsigned seed);
+
+ZOOSIMS_API int zoosims_summary(ZooSimsZoo* zoo, ZooSimsSummary* summary);
+ZOOSIMS_API ZooSimsColumn zoosims_animal_column(ZooSimsZoo* zoo, int column);
+ZOOSIMS_API ZooSimsColumn zoosims_enclosure_column(ZooSimsZoo* zoo, int column);
+
+/* Имя вида из каталога в UTF-8 (строка живет до конца процесса). NULL для неизвестного номера */
+ZOOSIMS_API const char* zoosims_species_name(int speciesId);
+
+static inline int32_t zoosims_read_int32(const ZooSimsColumn* column, size_t row) {
+    int32_t value;
+    memcpy(&value, (const char*)column->rows[row] + column->offset, sizeof(value));
+    return value;
+}
+
+static inline uint8_t zoosims_read_uint8(const ZooSimsColumn* column, size_t row) {
+    return *((const uint8_t*)column->rows[row] + column->offset);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif